@@ -1,37 +1,239 @@
 ﻿#pragma once
-#include <list>
+#include <limits>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include "memory_resource.hpp"
+#include "os_memory.hpp"
 
 namespace my {
 
-enum class block_status {
-    ALLOCATED, 
-    FREE
-};
-
 template <class T>
 class allocator;
 
-template<class T>
+// Per-type tuning of my::allocator. Allocations of types with cached set to
+// false bypass the per-thread caches and always go to the shared pool.
+template <class T>
+struct pool_traits {
+    static const bool cached = true;
+};
+
+// A single byte-granular pool shared by every allocator<T>, so memory freed
+// by one element type can be reused by any other. Alignment is handled per
+// request; blocks are aligned to 2 * sizeof(void*) unless more is asked for.
+//
+// The pool is a chain of arenas. When no free block fits, a new arena at
+// least as large as all current arenas together is added, and an arena whose
+// blocks have all been freed is returned to the system unless it is the last
+// one left.
+//
+// Every block starts with a boundary tag holding its own size, the size of
+// the block in front of it and the thread cache that handed it out, so both
+// neighbours of a block are found by pointer arithmetic. Free blocks carry
+// their free-list links in the payload and are filed in segregated free lists
+// by power-of-two size class (floor(log2(size))); adjacent free blocks are
+// merged as soon as a block is freed. A zero-sized allocated tag at the end
+// of every arena stops merging.
+//
+// Small blocks for the thread caches are taken from the smallest class that
+// fits. Everything else is carved from the front of the largest free block,
+// which leaves it room to grow in place.
+//
+// Requests above large_threshold bytes skip the arenas altogether. Each gets
+// its own mapping, aligned to and rounded up to the huge page size and
+// backed by huge pages where the system supports it, and is unmapped as soon
+// as it is freed. The tag of such a block carries large_flag, and its
+// prev_size holds the distance back to the start of the mapping. Where the
+// system can remap pages (mremap on Linux), expand() grows such a block in
+// place and reallocate() moves it without copying its contents.
+//
+// memory_pool itself is not synchronized; callers hold mutex around every
+// call.
 struct memory_pool {
-    memory_pool() {
-        max_size = 0xFFFFF;
-        pool = static_cast<typename allocator<T>::pointer>(::operator new(max_size * sizeof(T)));
-        blocks = { typename allocator<T>::block(pool, max_size - 1, block_status::FREE) };
+    typedef size_t size_type;
+
+    struct header {
+        size_type size;
+        size_type prev_size;
+        void* owner;
     };
-    ~memory_pool() {
-        ::operator delete(pool, max_size);
-    }
-    typename allocator<T>::size_type max_size;
-    typename allocator<T>::pointer pool;
-    std::list<typename allocator<T>::block> blocks;
+    struct free_links {
+        header* prev;
+        header* next;
+    };
+    struct arena {
+        void* memory;
+        arena* next;
+        size_type bytes;
+    };
+
+    static const size_type alignment = 2 * sizeof(void*);
+    static const size_type header_size = (sizeof(header) + alignment - 1) / alignment * alignment;
+    static const size_type min_block = header_size + (sizeof(free_links) + alignment - 1) / alignment * alignment;
+    static const size_type arena_size = (sizeof(arena) + alignment - 1) / alignment * alignment;
+    static const size_type classes = std::numeric_limits<size_type>::digits;
+    static const size_type free_flag = 1;
+    static const size_type large_flag = 2;
+    static const size_type initial_size = size_type(1) << 16;
+    static const size_type max_size = std::numeric_limits<size_type>::max() / 2;
+    static const size_type default_large_threshold = size_type(32) << 20;
+
+    memory_pool();
+    ~memory_pool();
+
+    void* allocate(size_type bytes, size_type align, bool largest);
+    void deallocate(void* p);
+    bool expand(void* p, size_type bytes);
+    void* reallocate(void* p, size_type bytes);
+    void reserve(size_type bytes);
+    static size_type block_size(size_type bytes) noexcept;
+    static size_type block_size(void* p) noexcept { return size(tag(p)); }
+    static void*& owner(void* p) noexcept { return tag(p)->owner; }
+
+    arena* arenas;
+    size_type reserved;
+    header* free_lists[classes];
+    size_type nonempty;
+    size_type large_threshold;
+    std::mutex mutex;
+
+private:
+    static size_type floor_log2(size_type n) noexcept;
+    static size_type size(const header* h) noexcept { return h->size & ~(free_flag | large_flag); }
+    static bool is_free(const header* h) noexcept { return (h->size & free_flag) != 0; }
+    static bool is_large(const header* h) noexcept { return (h->size & large_flag) != 0; }
+    static header* next(header* h) noexcept { return reinterpret_cast<header*>(reinterpret_cast<char*>(h) + size(h)); }
+    static header* prev(header* h) noexcept { return reinterpret_cast<header*>(reinterpret_cast<char*>(h) - h->prev_size); }
+    static free_links* links(header* h) noexcept { return reinterpret_cast<free_links*>(reinterpret_cast<char*>(h) + header_size); }
+    static void* payload(header* h) noexcept { return reinterpret_cast<char*>(h) + header_size; }
+    static header* tag(void* p) noexcept { return reinterpret_cast<header*>(static_cast<char*>(p) - header_size); }
+
+    void insert_free(header* h, size_type bytes);
+    void remove_free(header* h);
+    header* find_free(size_type bytes, bool largest);
+    header* align_block(header* h, size_type align);
+    void split(header* h, size_type bytes);
+    void add_arena(size_type bytes);
+    void release_arena(header* first);
+    void* allocate_large(size_type bytes, size_type align);
+    header* resize_large(header* h, size_type bytes, bool may_move);
 };
 
-template<class T>
-memory_pool<T>& pool() {
-    static memory_pool<T> pool;
+inline memory_pool& pool() {
+    static memory_pool pool;
     return pool;
 }
 
+// Adds an arena up front so that a block of the given size can be allocated
+// without growing the pool later.
+inline void reserve_pool(size_t bytes) {
+    std::lock_guard<std::mutex> lock(pool().mutex);
+    pool().reserve(bytes);
+}
+
+// Sets the size above which allocations get a huge-page mapping of their own
+// instead of a block in the pool.
+inline void set_large_allocation_threshold(size_t bytes) {
+    std::lock_guard<std::mutex> lock(pool().mutex);
+    pool().large_threshold = bytes;
+}
+
+// Per-thread magazines of small blocks in front of the shared pool. Blocks
+// are binned by their exact block size, so a deallocate followed by an
+// allocate of the same size is served without taking the pool lock. Empty
+// bins are refilled from the pool in batches that double on every miss, and
+// full bins hand half of their blocks back.
+//
+// Every block remembers the cache that handed it out. A block freed on
+// another thread is pushed onto its owner's lock-free return stack, which the
+// owner drains on its next allocate. When a thread exits its cache is flushed
+// and parked for reuse by the next thread; frees that reach a parked cache go
+// straight to the pool.
+struct thread_cache {
+    typedef memory_pool::size_type size_type;
+
+    static const size_type capacity = 32;
+    static const size_type max_block = 512;
+    static const size_type bin_count = max_block / memory_pool::alignment;
+
+    struct bin {
+        void* blocks[capacity];
+        size_type count;
+        size_type batch;
+    };
+
+    thread_cache();
+
+    static thread_cache* acquire();
+    void release();
+
+    void* allocate(size_type bytes, size_type align);
+    void deallocate(void* p, size_type bytes);
+
+    bin bins[bin_count];
+    std::atomic<void*> remote;
+    std::atomic<bool> parked;
+
+private:
+    bin* find_bin(size_type block) noexcept;
+    void refill(bin& b, size_type bytes);
+    void flush(bin& b, size_type keep);
+    void free_local(void* p, size_type block);
+    void push_remote(void* p);
+    void drain(bool to_pool);
+    static void*& link(void* p) noexcept { return *static_cast<void**>(p); }
+};
+
+struct thread_cache_registry {
+    ~thread_cache_registry() {
+        for (auto c : parked) {
+            delete c;
+        }
+    }
+    std::mutex mutex;
+    std::vector<thread_cache*> parked;
+};
+
+inline thread_cache_registry& cache_registry() {
+    static thread_cache_registry registry;
+    return registry;
+}
+
+struct thread_cache_owner {
+    thread_cache_owner() : cache(thread_cache::acquire()) {}
+    ~thread_cache_owner() { cache->release(); }
+    thread_cache* cache;
+};
+
+inline thread_cache& cache() {
+    thread_local thread_cache_owner owner;
+    return *owner.cache;
+}
+
+// The shared pool behind its thread caches as a memory_resource.
+class pool_resource : public memory_resource {
+protected:
+    void* do_allocate(size_t bytes, size_t align) override { return cache().allocate(bytes, align); }
+    void do_deallocate(void* p, size_t bytes, size_t) override { cache().deallocate(p, bytes); }
+    bool do_expand(void* p, size_t old_bytes, size_t new_bytes) override;
+    bool do_is_equal(const memory_resource& other) const noexcept override {
+        return dynamic_cast<const pool_resource*>(&other) != nullptr;
+    }
+};
+
+inline memory_resource* pool_memory_resource() noexcept {
+    static pool_resource resource;
+    return &resource;
+}
+
+// Allocates from the shared pool, or from the memory_resource it was
+// constructed with. Like std::pmr allocators, the resource stays with the
+// container: it is not propagated on assignment or swap, and copies of a
+// container go back to the pool.
 template <class T>
 class allocator {
 public:
@@ -42,91 +244,519 @@ public:
     typedef const T& const_reference;
     typedef size_t size_type;
     typedef ptrdiff_t difference_type;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::false_type propagate_on_container_move_assignment;
+    typedef std::false_type propagate_on_container_swap;
 
     template<class U> struct rebind { typedef allocator<U> other; };
 
-    allocator() noexcept { }
-    allocator(const allocator<T>&) noexcept { }
-    template<class U> allocator(const allocator<U>&) noexcept {}
+    allocator() noexcept : resource_(nullptr) { }
+    allocator(memory_resource* resource) noexcept : resource_(resource) { }
+    allocator(const allocator<T>& other) noexcept : resource_(other.resource_) { }
+    template<class U> allocator(const allocator<U>& other) noexcept : resource_(other.resource_) {}
 
     pointer allocate(size_type n);
     void deallocate(pointer p, size_type n);
+    bool expand_in_place(pointer p, size_type old_n, size_type new_n);
+    // Grows the block to new_n elements, possibly moving it, without copying
+    // its bytes. Returns nullptr when that is not possible; p stays valid.
+    pointer reallocate(pointer p, size_type old_n, size_type new_n);
 
     template <class... Args> void construct(pointer p, Args&&... args) {
         ::new (static_cast<void*>(p)) value_type(std::forward<Args>(args)...);
     };
     void destroy(pointer p) { p->~value_type(); };
 
-    size_type max_size() const noexcept { return pool<T>().max_size; }
+    size_type max_size() const noexcept { return memory_pool::max_size / sizeof(T); }
+    memory_resource* resource() const noexcept { return resource_ != nullptr ? resource_ : pool_memory_resource(); }
+    allocator select_on_container_copy_construction() const noexcept { return allocator(); }
 
-    struct block {
-        block(pointer start, size_type length, block_status status) noexcept
-            : start(start), length(length), status(status) {}
-        pointer start;
-        size_type length;
-        block_status status;
-    };
+private:
+    template <class U> friend class allocator;
 
+    memory_resource* resource_;
 };
 
-template <class T>
-typename allocator<T>::pointer allocator<T>::allocate(size_type n) {
-    for (auto a = pool<T>().blocks.begin(); a != pool<T>().blocks.end(); ++a) {
-        if (a->length > n && a->status == block_status::FREE) {
-            auto res = pool<T>().blocks.emplace(a, a->start, n, block_status::ALLOCATED);
-            a->start = a->start + n;
-            a->length = a->length - n;
-            return res->start;
+inline memory_pool::memory_pool() : arenas(nullptr), reserved(0), nonempty(0), large_threshold(default_large_threshold) {
+    for (auto& list : free_lists) {
+        list = nullptr;
+    }
+    add_arena(initial_size);
+}
+
+inline memory_pool::~memory_pool() {
+    while (arenas != nullptr) {
+        arena* a = arenas;
+        arenas = a->next;
+        ::operator delete(a->memory);
+    }
+}
+
+// Lays out a new arena as a single free block followed by the end tag.
+inline void memory_pool::add_arena(size_type bytes) {
+    void* memory = ::operator new(arena_size + bytes + header_size + alignment);
+    char* start = static_cast<char*>(memory) + (alignment - reinterpret_cast<size_t>(memory) % alignment) % alignment;
+    arena* a = reinterpret_cast<arena*>(start);
+    a->memory = memory;
+    a->next = arenas;
+    a->bytes = bytes;
+    arenas = a;
+    reserved += bytes;
+    header* first = reinterpret_cast<header*>(start + arena_size);
+    first->prev_size = 0;
+    header* end = reinterpret_cast<header*>(start + arena_size + bytes);
+    end->size = 0;
+    insert_free(first, bytes);
+}
+
+inline void memory_pool::release_arena(header* first) {
+    arena* a = reinterpret_cast<arena*>(reinterpret_cast<char*>(first) - arena_size);
+    remove_free(first);
+    for (arena** i = &arenas; *i != nullptr; i = &(*i)->next) {
+        if (*i == a) {
+            *i = a->next;
+            break;
+        }
+    }
+    reserved -= a->bytes;
+    ::operator delete(a->memory);
+}
+
+inline memory_pool::size_type memory_pool::floor_log2(size_type n) noexcept {
+    size_type log = 0;
+    while (n >>= 1) {
+        ++log;
+    }
+    return log;
+}
+
+inline memory_pool::size_type memory_pool::block_size(size_type bytes) noexcept {
+    size_type block = header_size + (bytes + alignment - 1) / alignment * alignment;
+    return block < min_block ? size_type(min_block) : block;
+}
+
+// Marks h as a free block of the given size and files it.
+inline void memory_pool::insert_free(header* h, size_type bytes) {
+    h->size = bytes | free_flag;
+    next(h)->prev_size = bytes;
+    auto c = floor_log2(bytes);
+    links(h)->prev = nullptr;
+    links(h)->next = free_lists[c];
+    if (free_lists[c] != nullptr) {
+        links(free_lists[c])->prev = h;
+    }
+    free_lists[c] = h;
+    nonempty |= size_type(1) << c;
+}
+
+inline void memory_pool::remove_free(header* h) {
+    auto c = floor_log2(size(h));
+    free_links* l = links(h);
+    if (l->prev != nullptr) {
+        links(l->prev)->next = l->next;
+    }
+    else {
+        free_lists[c] = l->next;
+    }
+    if (l->next != nullptr) {
+        links(l->next)->prev = l->prev;
+    }
+    if (free_lists[c] == nullptr) {
+        nonempty &= ~(size_type(1) << c);
+    }
+    h->size = size(h);
+}
+
+// Every block in a class above floor(log2(bytes)) fits, so the common case is
+// a bitmask lookup; only the class of the request itself has to be searched.
+inline memory_pool::header* memory_pool::find_free(size_type bytes, bool largest) {
+    auto c = floor_log2(bytes);
+    if (largest) {
+        if (nonempty >> c == 0) {
+            return nullptr;
+        }
+        auto top = floor_log2(nonempty);
+        if (top > c) {
+            return free_lists[top];
+        }
+    }
+    else if (c + 1 < classes) {
+        size_type larger = nonempty & ~((size_type(2) << c) - 1);
+        if (larger != 0) {
+            return free_lists[floor_log2(larger & (~larger + 1))];
         }
-        else if (a->length == n && a->status == block_status::FREE) {
-            a->status = block_status::ALLOCATED;
-            return a->start;
+    }
+    for (header* h = free_lists[c]; h != nullptr; h = links(h)->next) {
+        if (size(h) >= bytes) {
+            return h;
         }
     }
-    throw std::bad_alloc();
+    return nullptr;
 }
 
-template <class T>
-void allocator<T>::deallocate(pointer p, size_type n) {
+// Moves the start of the allocated block h forward until its payload is
+// aligned, handing the skipped front back as a free block.
+inline memory_pool::header* memory_pool::align_block(header* h, size_type align) {
+    char* p = static_cast<char*>(payload(h));
+    if (reinterpret_cast<size_t>(p) % align == 0) {
+        return h;
+    }
+    char* target = p + min_block;
+    target += (align - reinterpret_cast<size_t>(target) % align) % align;
+    size_type lead = target - p;
+    header* aligned = reinterpret_cast<header*>(reinterpret_cast<char*>(h) + lead);
+    aligned->size = size(h) - lead;
+    next(aligned)->prev_size = aligned->size;
+    insert_free(h, lead);
+    return aligned;
+}
+
+// Shrinks the allocated block h to bytes and frees the tail if it is large
+// enough to form a block of its own.
+inline void memory_pool::split(header* h, size_type bytes) {
+    size_type total = size(h);
+    if (total - bytes >= min_block) {
+        h->size = bytes;
+        insert_free(next(h), total - bytes);
+        next(h)->prev_size = bytes;
+    }
+}
+
+inline void* memory_pool::allocate_large(size_type bytes, size_type align) {
+    size_type offset = align > alignment ? (header_size + align - 1) / align * align : header_size;
+    size_type total = (offset + bytes + os::huge_page_size - 1) / os::huge_page_size * os::huge_page_size;
+    char* base = static_cast<char*>(os::map_huge(total));
+    if (base == nullptr) {
+        throw std::bad_alloc();
+    }
+    header* h = reinterpret_cast<header*>(base + offset - header_size);
+    h->size = total | large_flag;
+    h->prev_size = offset - header_size;
+    h->owner = nullptr;
+    return payload(h);
+}
+
+inline memory_pool::header* memory_pool::resize_large(header* h, size_type bytes, bool may_move) {
+    size_type lead = h->prev_size;
+    if (lead + header_size + bytes <= size(h)) {
+        return h;
+    }
+    size_type total = (lead + header_size + bytes + os::huge_page_size - 1) / os::huge_page_size * os::huge_page_size;
+    char* base = static_cast<char*>(os::remap_huge(reinterpret_cast<char*>(h) - lead, size(h), total, may_move));
+    if (base == nullptr) {
+        return nullptr;
+    }
+    h = reinterpret_cast<header*>(base + lead);
+    h->size = total | large_flag;
+    return h;
+}
+
+inline void* memory_pool::allocate(size_type bytes, size_type align, bool largest) {
+    if (bytes == 0) {
+        return nullptr;
+    }
+    if (bytes > max_size) {
+        throw std::bad_alloc();
+    }
+    if (bytes > large_threshold) {
+        return allocate_large(bytes, align);
+    }
+    size_type block = block_size(bytes);
+    size_type search = align > alignment ? block + align + min_block : block;
+    header* h = find_free(search, largest);
+    if (h == nullptr) {
+        add_arena(search > reserved ? search : reserved);
+        h = find_free(search, largest);
+    }
+    remove_free(h);
+    if (align > alignment) {
+        h = align_block(h, align);
+    }
+    split(h, block);
+    h->owner = nullptr;
+    return payload(h);
+}
+
+inline void memory_pool::deallocate(void* p) {
     if (p == nullptr) {
         return;
     }
-    for (auto a = pool<T>().blocks.begin(); a != pool<T>().blocks.end(); ++a) {
-        if (a->start == p && a->length == n) {
-            a->status = block_status::FREE;
-            if (a != pool<T>().blocks.begin()) {
-                auto i = a;
-                for (--i; i != pool<T>().blocks.begin();) {
-                    if (i->status == block_status::FREE) {
-                        a->start = i->start;
-                        a->length += i->length;
-                        i = pool<T>().blocks.erase(i);
-                        --i;
-                    }
-                    else {
-                        break;
-                    }
-                }
-            }
-            auto i = a;
-            for (++i; i != pool<T>().blocks.end();) {
-                if (i->status == block_status::FREE) {
-                    a->length += i->length;
-                    i = pool<T>().blocks.erase(i);
-                }
-                else {
-                    break;
-                }
-            }
+    header* h = tag(p);
+    if (is_large(h)) {
+        os::release(reinterpret_cast<char*>(h) - h->prev_size, size(h));
+        return;
+    }
+    size_type bytes = size(h);
+    header* after = next(h);
+    if (is_free(after)) {
+        remove_free(after);
+        bytes += size(after);
+    }
+    if (h->prev_size != 0 && is_free(prev(h))) {
+        h = prev(h);
+        remove_free(h);
+        bytes += size(h);
+    }
+    insert_free(h, bytes);
+    if (h->prev_size == 0 && next(h)->size == 0 && arenas->next != nullptr) {
+        release_arena(h);
+    }
+}
+
+// Grows the block at p to hold the given number of bytes by taking space
+// from the free block that directly follows it. Returns false if that is not
+// possible.
+inline bool memory_pool::expand(void* p, size_type bytes) {
+    if (p == nullptr || bytes > max_size) {
+        return false;
+    }
+    header* h = tag(p);
+    if (is_large(h)) {
+        return resize_large(h, bytes, false) != nullptr;
+    }
+    size_type block = block_size(bytes);
+    if (size(h) >= block) {
+        return true;
+    }
+    header* after = next(h);
+    if (!is_free(after) || size(h) + size(after) < block) {
+        return false;
+    }
+    remove_free(after);
+    h->size = size(h) + size(after);
+    next(h)->prev_size = size(h);
+    split(h, block);
+    return true;
+}
+
+// Only large blocks can move without a copy; for anything else this returns
+// nullptr and the caller falls back to allocate and copy.
+inline void* memory_pool::reallocate(void* p, size_type bytes) {
+    if (p == nullptr || bytes > max_size || !is_large(tag(p))) {
+        return nullptr;
+    }
+    header* h = resize_large(tag(p), bytes, true);
+    return h != nullptr ? payload(h) : nullptr;
+}
+
+inline void memory_pool::reserve(size_type bytes) {
+    size_type block = block_size(bytes);
+    if (find_free(block, true) == nullptr) {
+        add_arena(block);
+    }
+}
+
+inline thread_cache::thread_cache() : remote(nullptr), parked(false) {
+    for (auto& b : bins) {
+        b.count = 0;
+        b.batch = 1;
+    }
+}
+
+inline thread_cache* thread_cache::acquire() {
+    pool();
+    auto& registry = cache_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (registry.parked.empty()) {
+        return new thread_cache();
+    }
+    thread_cache* c = registry.parked.back();
+    registry.parked.pop_back();
+    c->parked = false;
+    return c;
+}
+
+inline void thread_cache::release() {
+    for (auto& b : bins) {
+        if (b.count > 0) {
+            flush(b, 0);
+        }
+        b.batch = 1;
+    }
+    parked = true;
+    drain(true);
+    auto& registry = cache_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.parked.push_back(this);
+}
+
+inline thread_cache::bin* thread_cache::find_bin(size_type block) noexcept {
+    return block <= max_block ? &bins[block / memory_pool::alignment - 1] : nullptr;
+}
+
+inline void thread_cache::refill(bin& b, size_type bytes) {
+    std::lock_guard<std::mutex> lock(pool().mutex);
+    b.blocks[b.count++] = pool().allocate(bytes, memory_pool::alignment, false);
+    try {
+        while (b.count < b.batch) {
+            b.blocks[b.count++] = pool().allocate(bytes, memory_pool::alignment, false);
         }
     }
+    catch (std::bad_alloc&) {
+        return;
+    }
+    if (b.batch < capacity / 2) {
+        b.batch *= 2;
+    }
+}
+
+inline void thread_cache::flush(bin& b, size_type keep) {
+    std::lock_guard<std::mutex> lock(pool().mutex);
+    while (b.count > keep) {
+        pool().deallocate(b.blocks[--b.count]);
+    }
+}
+
+inline void thread_cache::free_local(void* p, size_type block) {
+    bin* b = find_bin(block);
+    if (b == nullptr) {
+        std::lock_guard<std::mutex> lock(pool().mutex);
+        pool().deallocate(p);
+        return;
+    }
+    if (b->count == capacity) {
+        flush(*b, capacity / 2);
+    }
+    b->blocks[b->count++] = p;
+}
+
+// Both the push and the parked check are sequentially consistent, so either
+// release() sees the block when it drains or the pusher sees the cache parked
+// and drains it itself.
+inline void thread_cache::push_remote(void* p) {
+    void* head = remote.load(std::memory_order_relaxed);
+    do {
+        link(p) = head;
+    } while (!remote.compare_exchange_weak(head, p));
+    if (parked) {
+        drain(true);
+    }
+}
+
+inline void thread_cache::drain(bool to_pool) {
+    void* list = remote.exchange(nullptr);
+    while (list != nullptr) {
+        void* p = list;
+        list = link(list);
+        if (to_pool) {
+            std::lock_guard<std::mutex> lock(pool().mutex);
+            pool().deallocate(p);
+        }
+        else {
+            free_local(p, memory_pool::block_size(p));
+        }
+    }
+}
+
+inline void* thread_cache::allocate(size_type bytes, size_type align) {
+    if (remote.load(std::memory_order_relaxed) != nullptr) {
+        drain(false);
+    }
+    void* p;
+    bin* b = bytes > 0 && bytes <= memory_pool::max_size && align <= memory_pool::alignment
+        ? find_bin(memory_pool::block_size(bytes)) : nullptr;
+    if (b == nullptr) {
+        std::lock_guard<std::mutex> lock(pool().mutex);
+        p = pool().allocate(bytes, align, true);
+        if (p == nullptr) {
+            return p;
+        }
+    }
+    else {
+        if (b->count == 0) {
+            refill(*b, bytes);
+        }
+        p = b->blocks[--b->count];
+    }
+    memory_pool::owner(p) = this;
+    return p;
+}
+
+inline void thread_cache::deallocate(void* p, size_type /*bytes*/) {
+    if (p == nullptr) {
+        return;
+    }
+    auto owner = static_cast<thread_cache*>(memory_pool::owner(p));
+    if (owner == nullptr) {
+        std::lock_guard<std::mutex> lock(pool().mutex);
+        pool().deallocate(p);
+    }
+    else if (owner != this) {
+        owner->push_remote(p);
+    }
+    else {
+        free_local(p, memory_pool::block_size(p));
+    }
+}
+
+inline bool pool_resource::do_expand(void* p, size_t old_bytes, size_t new_bytes) {
+    if (new_bytes < old_bytes) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(pool().mutex);
+    return pool().expand(p, new_bytes);
+}
+
+template <class T>
+typename allocator<T>::pointer allocator<T>::allocate(size_type n) {
+    if (n > max_size()) {
+        throw std::bad_alloc();
+    }
+    if (resource_ != nullptr) {
+        return static_cast<pointer>(resource_->allocate(n * sizeof(T), alignof(T)));
+    }
+    if (pool_traits<T>::cached) {
+        return static_cast<pointer>(cache().allocate(n * sizeof(T), alignof(T)));
+    }
+    std::lock_guard<std::mutex> lock(pool().mutex);
+    return static_cast<pointer>(pool().allocate(n * sizeof(T), alignof(T), true));
+}
+
+template <class T>
+void allocator<T>::deallocate(pointer p, size_type n) {
+    if (resource_ != nullptr) {
+        if (p != nullptr) {
+            resource_->deallocate(p, n * sizeof(T), alignof(T));
+        }
+        return;
+    }
+    if (pool_traits<T>::cached) {
+        cache().deallocate(p, n * sizeof(T));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(pool().mutex);
+    pool().deallocate(p);
+}
+
+template <class T>
+bool allocator<T>::expand_in_place(pointer p, size_type old_n, size_type new_n) {
+    if (new_n == old_n) {
+        return true;
+    }
+    if (new_n < old_n || new_n > max_size()) {
+        return false;
+    }
+    if (resource_ != nullptr) {
+        return resource_->expand(p, old_n * sizeof(T), new_n * sizeof(T));
+    }
+    std::lock_guard<std::mutex> lock(pool().mutex);
+    return pool().expand(p, new_n * sizeof(T));
+}
+
+template <class T>
+typename allocator<T>::pointer allocator<T>::reallocate(pointer p, size_type old_n, size_type new_n) {
+    if (resource_ != nullptr || new_n <= old_n || new_n > max_size()) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(pool().mutex);
+    return static_cast<pointer>(pool().reallocate(p, new_n * sizeof(T)));
 }
 
 template <class T, class U>
-constexpr bool operator== (const allocator<T>&, const allocator<U>&) noexcept {return true;}
+bool operator== (const allocator<T>& a, const allocator<U>& b) noexcept { return *a.resource() == *b.resource(); }
 
 template <class T, class U>
-constexpr bool operator!= (const allocator<T>&, const allocator<U>&) noexcept {return false;}
+bool operator!= (const allocator<T>& a, const allocator<U>& b) noexcept { return !(a == b); }
 
 
 }
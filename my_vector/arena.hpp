@@ -0,0 +1,188 @@
+#pragma once
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <utility>
+#include "memory_resource.hpp"
+
+namespace my {
+
+// A monotonic arena. Allocations bump a pointer through chunks taken from
+// the system, each chunk twice as large as the previous one. Only the most
+// recent allocation can be given back or grown; everything else stays in
+// place until reset() releases it all at once.
+class arena {
+public:
+    explicit arena(size_t chunk_size = 64 * 1024);
+    ~arena();
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    void* allocate(size_t bytes, size_t align);
+    void deallocate(void* p, size_t bytes) noexcept;
+    bool expand(void* p, size_t old_bytes, size_t new_bytes) noexcept;
+
+    // Frees every allocation. The largest chunk is kept for reuse.
+    void reset() noexcept;
+
+    size_t used() const noexcept { return used_ + (current_ - begin_); }
+private:
+    struct chunk {
+        chunk* next;
+        size_t size;
+    };
+
+    static const size_t header_size = (sizeof(chunk) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    chunk* chunks_;
+    char* begin_;
+    char* current_;
+    char* end_;
+    char* last_;
+    size_t used_;
+    size_t chunk_size_;
+
+    void add_chunk(size_t bytes);
+    void use_chunk(chunk* c) noexcept;
+};
+
+template <class T>
+class arena_allocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef T& reference;
+    typedef const T* const_pointer;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<class U> struct rebind { typedef arena_allocator<U> other; };
+
+    explicit arena_allocator(arena& a) noexcept : arena_(&a) {}
+    template<class U> arena_allocator(const arena_allocator<U>& other) noexcept : arena_(&other.resource()) {}
+
+    pointer allocate(size_type n) {
+        if (n > max_size()) {
+            throw std::bad_alloc();
+        }
+        return static_cast<pointer>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(pointer p, size_type n) noexcept { arena_->deallocate(p, n * sizeof(T)); }
+    bool expand_in_place(pointer p, size_type old_n, size_type new_n) noexcept {
+        return new_n <= max_size() && arena_->expand(p, old_n * sizeof(T), new_n * sizeof(T));
+    }
+
+    template <class... Args> void construct(pointer p, Args&&... args) {
+        ::new (static_cast<void*>(p)) value_type(std::forward<Args>(args)...);
+    };
+    void destroy(pointer p) { p->~value_type(); };
+
+    size_type max_size() const noexcept { return std::numeric_limits<size_type>::max() / 2 / sizeof(T); }
+    arena& resource() const noexcept { return *arena_; }
+private:
+    arena* arena_;
+};
+
+template <class T, class U>
+bool operator== (const arena_allocator<T>& a, const arena_allocator<U>& b) noexcept { return &a.resource() == &b.resource(); }
+
+template <class T, class U>
+bool operator!= (const arena_allocator<T>& a, const arena_allocator<U>& b) noexcept { return !(a == b); }
+
+// An arena as a memory_resource, so it can back my::allocator.
+class arena_resource : public memory_resource {
+public:
+    explicit arena_resource(arena& a) noexcept : arena_(&a) {}
+    arena& get_arena() const noexcept { return *arena_; }
+
+protected:
+    void* do_allocate(size_t bytes, size_t align) override { return arena_->allocate(bytes, align); }
+    void do_deallocate(void* p, size_t bytes, size_t) override { arena_->deallocate(p, bytes); }
+    bool do_expand(void* p, size_t old_bytes, size_t new_bytes) override { return arena_->expand(p, old_bytes, new_bytes); }
+    bool do_is_equal(const memory_resource& other) const noexcept override {
+        auto r = dynamic_cast<const arena_resource*>(&other);
+        return r != nullptr && r->arena_ == arena_;
+    }
+
+private:
+    arena* arena_;
+};
+
+inline arena::arena(size_t chunk_size) : chunks_(nullptr), begin_(nullptr), current_(nullptr), end_(nullptr),
+    last_(nullptr), used_(0), chunk_size_(chunk_size > 0 ? chunk_size : 1) {}
+
+inline arena::~arena() {
+    while (chunks_ != nullptr) {
+        chunk* c = chunks_;
+        chunks_ = c->next;
+        ::operator delete(c);
+    }
+}
+
+inline void arena::use_chunk(chunk* c) noexcept {
+    begin_ = reinterpret_cast<char*>(c) + header_size;
+    current_ = begin_;
+    end_ = begin_ + c->size;
+    last_ = nullptr;
+}
+
+inline void arena::add_chunk(size_t bytes) {
+    size_t size = chunks_ != nullptr ? chunks_->size * 2 : chunk_size_;
+    while (size < bytes) {
+        size *= 2;
+    }
+    chunk* c = static_cast<chunk*>(::operator new(header_size + size));
+    c->next = chunks_;
+    c->size = size;
+    chunks_ = c;
+    used_ += current_ - begin_;
+    use_chunk(c);
+}
+
+inline void* arena::allocate(size_t bytes, size_t align) {
+    if (bytes == 0) {
+        return nullptr;
+    }
+    size_t padding = (align - reinterpret_cast<size_t>(current_) % align) % align;
+    if (current_ == nullptr || padding > static_cast<size_t>(end_ - current_) || bytes > static_cast<size_t>(end_ - current_) - padding) {
+        if (bytes > std::numeric_limits<size_t>::max() / 4 - align) {
+            throw std::bad_alloc();
+        }
+        add_chunk(bytes + align);
+        padding = (align - reinterpret_cast<size_t>(current_) % align) % align;
+    }
+    last_ = current_ + padding;
+    current_ = last_ + bytes;
+    return last_;
+}
+
+inline void arena::deallocate(void* p, size_t bytes) noexcept {
+    if (p != nullptr && p == last_ && last_ + bytes == current_) {
+        current_ = last_;
+        last_ = nullptr;
+    }
+}
+
+inline bool arena::expand(void* p, size_t old_bytes, size_t new_bytes) noexcept {
+    if (p == nullptr || p != last_ || last_ + old_bytes != current_ || new_bytes > static_cast<size_t>(end_ - last_)) {
+        return false;
+    }
+    current_ = last_ + new_bytes;
+    return true;
+}
+
+inline void arena::reset() noexcept {
+    if (chunks_ == nullptr) {
+        return;
+    }
+    while (chunks_->next != nullptr) {
+        chunk* c = chunks_->next;
+        chunks_->next = c->next;
+        ::operator delete(c);
+    }
+    used_ = 0;
+    use_chunk(chunks_);
+}
+
+}
@@ -0,0 +1,299 @@
+#pragma once
+#include <atomic>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include "allocator.hpp"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace my {
+
+inline size_t highest_bit(size_t n) noexcept {
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanReverse64(&index, n);
+    return index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, n);
+    return index;
+#else
+    return std::numeric_limits<unsigned long long>::digits - 1 - __builtin_clzll(n);
+#endif
+}
+
+// An append-only vector that many threads can grow at once. push_back and
+// grow_by claim their indices with a single fetch_add and never wait for
+// each other. Elements live in segments that double in size and are never
+// moved, so references stay valid while other threads append.
+//
+// Elements can finish construction out of order, and size() only covers the
+// prefix that is complete. An element finished in order moves the size past
+// itself directly; one finished early sets its ready flag instead, and the
+// thread that later moves the size up to it carries the size over it. Any
+// thread may read an index below size(). If an element's constructor throws, or its segment cannot be
+// allocated, the size stops in front of it.
+//
+// clear(), assignment and destruction must not run concurrently with
+// anything else.
+template <class T, class Allocator = allocator<T>> class concurrent_vector {
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<std::atomic<bool>> flag_allocator;
+    typedef std::allocator_traits<flag_allocator> flag_traits;
+public:
+    typedef T value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    typedef T* pointer;
+    typedef Allocator allocator_type;
+
+    static const size_type first_segment = 64;
+    static const size_type max_segments = std::numeric_limits<size_type>::digits - 6;
+
+    class iterator : public std::iterator<
+        std::random_access_iterator_tag, T, ptrdiff_t, T*, T&>
+    {
+    public:
+        iterator() : container_(nullptr), index_(0) {};
+        iterator(concurrent_vector* container, size_type index) : container_(container), index_(index) {}
+
+        bool operator== (const iterator& other) const { return index_ == other.index_; };
+        bool operator!= (const iterator& other) const { return index_ != other.index_; };
+        bool operator< (const iterator& other) const { return index_ < other.index_; };
+        bool operator> (const iterator& other) const { return index_ > other.index_; };
+        bool operator<= (const iterator& other) const { return index_ <= other.index_; };
+        bool operator>= (const iterator& other) const { return index_ >= other.index_; };
+
+        iterator& operator++() { ++index_; return *this; };
+        iterator operator++(int) { iterator it(*this); ++index_; return it; };
+        iterator& operator--() { --index_; return *this; };
+        iterator operator--(int) { iterator it(*this); --index_; return it; };
+        iterator& operator+=(difference_type n) { index_ += n; return *this; };
+        iterator operator+(difference_type n) const { return iterator(container_, index_ + n); };
+        friend iterator operator+(difference_type n, const iterator& that) { return that + n; };
+        iterator& operator-=(difference_type n) { index_ -= n; return *this; };
+        iterator operator-(difference_type n) const { return iterator(container_, index_ - n); };
+        difference_type operator-(const iterator& other) const { return index_ - other.index_; }
+
+        reference operator*() const { return (*container_)[index_]; };
+        pointer operator->() const { return &(*container_)[index_]; };
+        reference operator[](difference_type n) const { return (*container_)[index_ + n]; };
+
+    private:
+        concurrent_vector* container_;
+        size_type index_;
+    };
+
+    concurrent_vector() : concurrent_vector(Allocator()) {}
+    explicit concurrent_vector(const Allocator& alloc);
+    concurrent_vector(const concurrent_vector&) = delete;
+    concurrent_vector& operator=(const concurrent_vector&) = delete;
+    ~concurrent_vector();
+
+    allocator_type get_allocator() const { return allocator_; }
+
+    // Iterates over the elements published when end() is called.
+    iterator begin() noexcept { return iterator(this, 0); }
+    iterator end() noexcept { return iterator(this, size()); }
+
+    size_type size() const noexcept { return size_.load(std::memory_order_acquire); }
+    size_type max_size() const noexcept { return first_segment * ((size_type(1) << (max_segments - 1)) - 1); }
+    bool empty() const noexcept { return size() == 0; }
+
+    reference operator[](size_type n) { return segments_[segment_of(n)].load(std::memory_order_relaxed)[offset_in(n)]; }
+    const_reference operator[](size_type n) const { return segments_[segment_of(n)].load(std::memory_order_relaxed)[offset_in(n)]; }
+    reference at(size_type n);
+    const_reference at(size_type n) const;
+
+    // Both return the index of the first new element.
+    size_type push_back(const T& x) { return emplace_back(x); }
+    size_type push_back(T&& x) { return emplace_back(std::move(x)); }
+    template<class... Args> size_type emplace_back(Args&&... args);
+    // Appends n value-initialized elements, or n copies of value, as one
+    // contiguous range of indices.
+    size_type grow_by(size_type n);
+    size_type grow_by(size_type n, const T& value);
+
+    void clear() noexcept;
+private:
+    alignas(64) std::atomic<size_type> reserved_;
+    alignas(64) std::atomic<size_type> size_;
+    std::atomic<pointer> segments_[max_segments];
+    std::atomic<std::atomic<bool>*> ready_[max_segments];
+    allocator_type allocator_;
+
+    static size_type segment_of(size_type n) noexcept { return highest_bit(n / first_segment + 1); }
+    static size_type offset_in(size_type n) noexcept { return n - first_segment * ((size_type(1) << segment_of(n)) - 1); }
+    static size_type segment_size(size_type k) noexcept { return first_segment << k; }
+
+    size_type claim(size_type n);
+    void add_segment(size_type k);
+    bool is_ready(size_type n) const noexcept;
+    void publish(size_type n) noexcept;
+};
+
+template <class T, class Allocator>
+concurrent_vector<T, Allocator>::concurrent_vector(const Allocator& alloc) : reserved_(0), size_(0), allocator_(alloc) {
+    for (size_type k = 0; k < max_segments; ++k) {
+        segments_[k].store(nullptr, std::memory_order_relaxed);
+        ready_[k].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+template <class T, class Allocator>
+concurrent_vector<T, Allocator>::~concurrent_vector() {
+    clear();
+    flag_allocator flags(allocator_);
+    for (size_type k = 0; k < max_segments; ++k) {
+        if (segments_[k].load() != nullptr) {
+            alloc_traits::deallocate(allocator_, segments_[k].load(), segment_size(k));
+        }
+        std::atomic<bool>* ready = ready_[k].load();
+        if (ready != nullptr) {
+            for (size_type i = 0; i < segment_size(k); ++i) {
+                flag_traits::destroy(flags, ready + i);
+            }
+            flag_traits::deallocate(flags, ready, segment_size(k));
+        }
+    }
+}
+
+template <class T, class Allocator>
+typename concurrent_vector<T, Allocator>::reference concurrent_vector<T, Allocator>::at(size_type n) {
+    if (n >= size()) {
+        throw std::out_of_range("Out of range");
+    }
+    return (*this)[n];
+}
+
+template <class T, class Allocator>
+typename concurrent_vector<T, Allocator>::const_reference concurrent_vector<T, Allocator>::at(size_type n) const {
+    if (n >= size()) {
+        throw std::out_of_range("Out of range");
+    }
+    return (*this)[n];
+}
+
+// Installs segment k unless another thread got there first, in which case
+// the loser frees its copy. The ready flags go in before the elements, so a
+// segment with elements always has its flags.
+template <class T, class Allocator>
+void concurrent_vector<T, Allocator>::add_segment(size_type k) {
+    if (ready_[k].load(std::memory_order_acquire) == nullptr) {
+        flag_allocator flags(allocator_);
+        std::atomic<bool>* ready = flag_traits::allocate(flags, segment_size(k));
+        for (size_type i = 0; i < segment_size(k); ++i) {
+            flag_traits::construct(flags, ready + i, false);
+        }
+        std::atomic<bool>* expected = nullptr;
+        if (!ready_[k].compare_exchange_strong(expected, ready)) {
+            flag_traits::deallocate(flags, ready, segment_size(k));
+        }
+    }
+    if (segments_[k].load(std::memory_order_acquire) == nullptr) {
+        pointer elements = alloc_traits::allocate(allocator_, segment_size(k));
+        pointer expected = nullptr;
+        if (!segments_[k].compare_exchange_strong(expected, elements)) {
+            alloc_traits::deallocate(allocator_, elements, segment_size(k));
+        }
+    }
+}
+
+template <class T, class Allocator>
+typename concurrent_vector<T, Allocator>::size_type concurrent_vector<T, Allocator>::claim(size_type n) {
+    if (n > max_size()) {
+        throw std::length_error("Too many elements");
+    }
+    size_type first = reserved_.fetch_add(n);
+    if (first > max_size() - n) {
+        throw std::length_error("Too many elements");
+    }
+    if (n > 0) {
+        for (size_type k = segment_of(first); k <= segment_of(first + n - 1); ++k) {
+            add_segment(k);
+        }
+    }
+    return first;
+}
+
+template <class T, class Allocator>
+bool concurrent_vector<T, Allocator>::is_ready(size_type n) const noexcept {
+    std::atomic<bool>* ready = ready_[segment_of(n)].load(std::memory_order_acquire);
+    return ready != nullptr && ready[offset_in(n)].load();
+}
+
+// Moves size_ past n, or marks n ready if elements in front of it are still
+// under construction, then moves size_ over the ready elements that follow.
+// The flag store and the size_ updates are sequentially consistent, so of two
+// threads finishing neighbouring elements at least one sees the other's work.
+template <class T, class Allocator>
+void concurrent_vector<T, Allocator>::publish(size_type n) noexcept {
+    size_type current = n;
+    if (size_.compare_exchange_strong(current, n + 1)) {
+        current = n + 1;
+    }
+    else {
+        ready_[segment_of(n)].load(std::memory_order_relaxed)[offset_in(n)].store(true);
+        current = size_.load();
+    }
+    while (current < max_size() && is_ready(current)) {
+        if (size_.compare_exchange_weak(current, current + 1)) {
+            ++current;
+        }
+    }
+}
+
+template <class T, class Allocator>
+template <class... Args>
+typename concurrent_vector<T, Allocator>::size_type concurrent_vector<T, Allocator>::emplace_back(Args&&... args) {
+    size_type n = claim(1);
+    alloc_traits::construct(allocator_, &(*this)[n], std::forward<Args>(args)...);
+    publish(n);
+    return n;
+}
+
+template <class T, class Allocator>
+typename concurrent_vector<T, Allocator>::size_type concurrent_vector<T, Allocator>::grow_by(size_type n) {
+    size_type first = claim(n);
+    for (size_type i = first; i < first + n; ++i) {
+        alloc_traits::construct(allocator_, &(*this)[i]);
+        publish(i);
+    }
+    return first;
+}
+
+template <class T, class Allocator>
+typename concurrent_vector<T, Allocator>::size_type concurrent_vector<T, Allocator>::grow_by(size_type n, const T& value) {
+    size_type first = claim(n);
+    for (size_type i = first; i < first + n; ++i) {
+        alloc_traits::construct(allocator_, &(*this)[i], value);
+        publish(i);
+    }
+    return first;
+}
+
+// Destroys every element that finished construction and keeps the segments.
+template <class T, class Allocator>
+void concurrent_vector<T, Allocator>::clear() noexcept {
+    size_type size = size_.load();
+    size_type reserved = reserved_.load();
+    for (size_type i = 0; i < reserved; ++i) {
+        std::atomic<bool>* ready = ready_[segment_of(i)].load();
+        bool constructed = ready != nullptr && ready[offset_in(i)].load();
+        if (constructed || i < size) {
+            alloc_traits::destroy(allocator_, &(*this)[i]);
+        }
+        if (constructed) {
+            ready[offset_in(i)].store(false);
+        }
+    }
+    reserved_.store(0);
+    size_.store(0);
+}
+
+}
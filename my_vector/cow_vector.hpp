@@ -0,0 +1,288 @@
+#pragma once
+#include <atomic>
+#include <algorithm>
+#include "allocator.hpp"
+#include "my_vector.hpp"
+
+namespace my {
+
+// A vector whose copies share one reference-counted buffer. Copying only
+// bumps the count; the first mutating call on a shared vector clones the
+// elements into a buffer of its own. Const members read the buffer directly
+// and never touch the count, so copies can be read from any number of
+// threads while other copies are modified.
+//
+// Every non-const member that can hand out or change elements detaches, so
+// keep a const reference for read-only access. The ones that hand out a
+// mutable pointer, reference or iterator (operator[], data(), begin(), ...)
+// also mark the buffer unshareable: copies made while it is marked clone the
+// elements at once, so later writes through what was handed out never reach
+// them. clear() makes the buffer shareable again. An empty vector holds no
+// buffer.
+template <class T, class Allocator = allocator<T>> class cow_vector {
+    typedef vector<T, Allocator> vector_type;
+
+    // shareable is only cleared while refs is 1, so it is only ever read and
+    // written by the one vector holding the buffer.
+    struct buffer {
+        std::atomic<size_t> refs;
+        bool shareable;
+        vector_type elements;
+
+        explicit buffer(const Allocator& alloc) : refs(1), shareable(true), elements(alloc) {}
+        buffer(const vector_type& x, const Allocator& alloc) : refs(1), shareable(true), elements(x, alloc) {}
+    };
+
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<buffer> buffer_allocator;
+    typedef std::allocator_traits<buffer_allocator> buffer_traits;
+public:
+    typedef T value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    typedef Allocator allocator_type;
+
+    cow_vector() : buffer_(nullptr), allocator_() {};
+    explicit cow_vector(const Allocator& alloc) : buffer_(nullptr), allocator_(alloc) {};
+    cow_vector(size_type n, const T& value, const Allocator& alloc = Allocator());
+    cow_vector(std::initializer_list<T>, const Allocator& alloc = Allocator());
+    cow_vector(const cow_vector& x);
+    cow_vector(cow_vector&& x) noexcept;
+    ~cow_vector() { release(); }
+
+    cow_vector& operator=(const cow_vector& x);
+    cow_vector& operator=(cow_vector&& x) noexcept;
+
+    allocator_type get_allocator() const { return allocator_; }
+
+    size_type size() const noexcept { return buffer_ != nullptr ? buffer_->elements.size() : 0; }
+    size_type capacity() const noexcept { return buffer_ != nullptr ? buffer_->elements.capacity() : 0; }
+    bool empty() const noexcept { return size() == 0; }
+    // The number of vectors sharing this buffer, 0 for an empty vector.
+    size_type use_count() const noexcept { return buffer_ != nullptr ? buffer_->refs.load(std::memory_order_relaxed) : 0; }
+
+    const_iterator begin() const noexcept { return data(); }
+    const_iterator end() const noexcept { return data() + size(); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+    const_reference operator[](size_type n) const { return data()[n]; }
+    const_reference at(size_type n) const;
+    const_reference front() const { return data()[0]; }
+    const_reference back() const { return data()[size() - 1]; }
+    const_pointer data() const noexcept { return buffer_ != nullptr ? buffer_->elements.data() : nullptr; }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + size(); }
+    reference operator[](size_type n) { return data()[n]; }
+    reference at(size_type n);
+    reference front() { return data()[0]; }
+    reference back() { return data()[size() - 1]; }
+    pointer data() { return buffer_ != nullptr ? expose().data() : nullptr; }
+
+    void reserve(size_type n) { if (n > capacity()) own().reserve(n); }
+    void shrink_to_fit() { if (buffer_ != nullptr) own().shrink_to_fit(); }
+    void resize(size_type sz) { if (sz != size()) own().resize(sz); }
+    void resize(size_type sz, const T& c) { if (sz != size()) own().resize(sz, c); }
+
+    void push_back(const T& x) { emplace_back(x); }
+    void push_back(T&& x) { emplace_back(std::move(x)); }
+    template<class... Args> void emplace_back(Args&&... args);
+    void pop_back() { own().pop_back(); }
+    iterator insert(const_iterator position, const T& x);
+    iterator erase(const_iterator position) { return erase(position, position + 1); }
+    iterator erase(const_iterator first, const_iterator last);
+
+    void swap(cow_vector&) noexcept;
+    // Drops this vector's reference without cloning a shared buffer.
+    void clear() noexcept;
+private:
+    buffer* buffer_;
+    allocator_type allocator_;
+
+    vector_type& own();
+    vector_type& expose();
+    buffer* make_buffer(const vector_type* source);
+    void release() noexcept;
+};
+
+template <class T, class Allocator>
+cow_vector<T, Allocator>::cow_vector(size_type n, const T& value, const Allocator& alloc) : cow_vector(alloc) {
+    if (n > 0) {
+        own().assign(n, value);
+    }
+}
+
+template <class T, class Allocator>
+cow_vector<T, Allocator>::cow_vector(std::initializer_list<T> il, const Allocator& alloc) : cow_vector(alloc) {
+    if (il.size() > 0) {
+        own().assign(il);
+    }
+}
+
+template <class T, class Allocator>
+cow_vector<T, Allocator>::cow_vector(const cow_vector& x) : buffer_(x.buffer_), allocator_(x.allocator_) {
+    if (buffer_ == nullptr) {
+        return;
+    }
+    if (buffer_->shareable) {
+        buffer_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    else {
+        buffer_ = make_buffer(&x.buffer_->elements);
+    }
+}
+
+template <class T, class Allocator>
+cow_vector<T, Allocator>::cow_vector(cow_vector&& x) noexcept : buffer_(x.buffer_), allocator_(x.allocator_) {
+    x.buffer_ = nullptr;
+}
+
+template <class T, class Allocator>
+cow_vector<T, Allocator>& cow_vector<T, Allocator>::operator=(const cow_vector& x) {
+    cow_vector tmp(x);
+    swap(tmp);
+    return *this;
+}
+
+template <class T, class Allocator>
+cow_vector<T, Allocator>& cow_vector<T, Allocator>::operator=(cow_vector&& x) noexcept {
+    cow_vector tmp(std::move(x));
+    swap(tmp);
+    return *this;
+}
+
+// A count of one means no other vector can see the buffer, and only the
+// owner of a reference can add another, so the buffer stays unshared while
+// this vector changes it. The acquire load pairs with the release in
+// release(), so writes made through a copy that has since gone are visible.
+template <class T, class Allocator>
+typename cow_vector<T, Allocator>::vector_type& cow_vector<T, Allocator>::own() {
+    if (buffer_ == nullptr) {
+        buffer_ = make_buffer(nullptr);
+    }
+    else if (buffer_->refs.load(std::memory_order_acquire) != 1) {
+        buffer* copy = make_buffer(&buffer_->elements);
+        release();
+        buffer_ = copy;
+    }
+    return buffer_->elements;
+}
+
+// Detaches and marks the buffer unshareable, for members that hand out
+// mutable access to the elements.
+template <class T, class Allocator>
+typename cow_vector<T, Allocator>::vector_type& cow_vector<T, Allocator>::expose() {
+    vector_type& elements = own();
+    buffer_->shareable = false;
+    return elements;
+}
+
+template <class T, class Allocator>
+typename cow_vector<T, Allocator>::buffer* cow_vector<T, Allocator>::make_buffer(const vector_type* source) {
+    buffer_allocator alloc(allocator_);
+    buffer* b = buffer_traits::allocate(alloc, 1);
+    try {
+        if (source != nullptr) {
+            buffer_traits::construct(alloc, b, *source, allocator_);
+        }
+        else {
+            buffer_traits::construct(alloc, b, allocator_);
+        }
+    }
+    catch (...) {
+        buffer_traits::deallocate(alloc, b, 1);
+        throw;
+    }
+    return b;
+}
+
+template <class T, class Allocator>
+void cow_vector<T, Allocator>::release() noexcept {
+    if (buffer_ != nullptr && buffer_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        buffer_allocator alloc(allocator_);
+        buffer_traits::destroy(alloc, buffer_);
+        buffer_traits::deallocate(alloc, buffer_, 1);
+    }
+    buffer_ = nullptr;
+}
+
+template <class T, class Allocator>
+typename cow_vector<T, Allocator>::const_reference cow_vector<T, Allocator>::at(size_type n) const {
+    if (n >= size()) {
+        throw std::out_of_range("Out of range");
+    }
+    return (*this)[n];
+}
+
+template <class T, class Allocator>
+typename cow_vector<T, Allocator>::reference cow_vector<T, Allocator>::at(size_type n) {
+    if (n >= size()) {
+        throw std::out_of_range("Out of range");
+    }
+    return (*this)[n];
+}
+
+// args may refer into this vector: a shared buffer outlives the clone, since
+// other vectors still hold it, and vector::emplace_back copes with arguments
+// in a buffer it reallocates.
+template <class T, class Allocator>
+template <class... Args>
+void cow_vector<T, Allocator>::emplace_back(Args&&... args) {
+    own().emplace_back(std::forward<Args>(args)...);
+}
+
+// Positions are turned into indices first, since cloning moves the elements.
+// The returned iterator is mutable, so the buffer becomes unshareable.
+template <class T, class Allocator>
+typename cow_vector<T, Allocator>::iterator cow_vector<T, Allocator>::insert(const_iterator position, const T& x) {
+    size_type index = position - cbegin();
+    vector_type& elements = expose();
+    return elements.insert(elements.begin() + index, x).pos_;
+}
+
+template <class T, class Allocator>
+typename cow_vector<T, Allocator>::iterator cow_vector<T, Allocator>::erase(const_iterator first, const_iterator last) {
+    size_type from = first - cbegin();
+    size_type to = last - cbegin();
+    if (from == to) {
+        return data() + from;
+    }
+    vector_type& elements = expose();
+    return elements.erase(elements.begin() + from, elements.begin() + to).pos_;
+}
+
+template <class T, class Allocator>
+void cow_vector<T, Allocator>::swap(cow_vector& other) noexcept {
+    using std::swap;
+    swap(buffer_, other.buffer_);
+    swap(allocator_, other.allocator_);
+}
+
+template <class T, class Allocator>
+void cow_vector<T, Allocator>::clear() noexcept {
+    if (buffer_ != nullptr && buffer_->refs.load(std::memory_order_acquire) == 1) {
+        buffer_->elements.clear();
+        buffer_->shareable = true;
+    }
+    else {
+        release();
+    }
+}
+
+// Vectors sharing a buffer compare equal without looking at the elements.
+template <class T, class Allocator>
+bool operator==(const cow_vector<T, Allocator>& x, const cow_vector<T, Allocator>& y) {
+    return x.size() == y.size() && (x.data() == y.data() || simd::equal<T>(x.data(), y.data(), x.size()));
+}
+
+template <class T, class Allocator>
+bool operator!=(const cow_vector<T, Allocator>& x, const cow_vector<T, Allocator>& y) {
+    return !(x == y);
+}
+
+}
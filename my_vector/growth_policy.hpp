@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <limits>
+
+namespace my {
+
+// Growth policies decide how many elements to reserve when a container
+// needs room for at least n elements and currently holds capacity.
+// Requests that do not grow the buffer (shrink_to_fit) get exactly n from
+// every policy.
+
+struct power_of_two_growth {
+    template <class T>
+    static size_t next_capacity(size_t capacity, size_t n) noexcept {
+        if (n <= capacity) {
+            return n;
+        }
+        for (size_t shift = 1; shift < std::numeric_limits<size_t>::digits; shift <<= 1) {
+            n |= n >> shift;
+        }
+        return n + 1 != 0 ? n + 1 : n;
+    }
+};
+
+struct one_and_half_growth {
+    template <class T>
+    static size_t next_capacity(size_t capacity, size_t n) noexcept {
+        if (n <= capacity) {
+            return n;
+        }
+        size_t grown = capacity + capacity / 2;
+        return grown > n ? grown : n;
+    }
+};
+
+template <size_t Step = 1024>
+struct fixed_step_growth {
+    static_assert(Step > 0, "Growth step must be positive");
+
+    template <class T>
+    static size_t next_capacity(size_t capacity, size_t n) noexcept {
+        if (n <= capacity) {
+            return n;
+        }
+        size_t rounded = (n + Step - 1) / Step * Step;
+        return rounded >= n ? rounded : n;
+    }
+};
+
+// Grows by 1.5x and then rounds the byte size up to the next allocator size
+// class (four classes per power of two, as in jemalloc/tcmalloc), so the
+// slack the allocator hands out anyway becomes usable capacity.
+struct size_class_growth {
+    template <class T>
+    static size_t next_capacity(size_t capacity, size_t n) noexcept {
+        if (n <= capacity) {
+            return n;
+        }
+        size_t target = one_and_half_growth::next_capacity<T>(capacity, n);
+        if (target > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            return target;
+        }
+        size_t bytes = size_class(target * sizeof(T));
+        return bytes / sizeof(T);
+    }
+
+    static size_t size_class(size_t bytes) noexcept {
+        const size_t quantum = 16;
+        if (bytes <= 8 * quantum) {
+            return (bytes + quantum - 1) / quantum * quantum;
+        }
+        size_t high = bytes - 1;
+        size_t log = 0;
+        while (high >>= 1) {
+            ++log;
+        }
+        size_t step = size_t(1) << (log - 2);
+        size_t rounded = (bytes + step - 1) / step * step;
+        return rounded >= bytes ? rounded : bytes;
+    }
+};
+
+}
@@ -1,8 +1,27 @@
 #include "my_vector.hpp"
 #include <vector>
+#include <thread>
+#include <atomic>
 #define CATCH_CONFIG_RUNNER
 #include "catch.hpp"
 #include "allocator.hpp"
+#include "small_vector.hpp"
+#include "static_vector.hpp"
+#include "arena.hpp"
+#include "memory_resource.hpp"
+#include "reserved_vector.hpp"
+#include "mapped_vector.hpp"
+#include "stable_vector.hpp"
+#include "concurrent_vector.hpp"
+#include "soa_vector.hpp"
+#include "simd.hpp"
+#include "parallel.hpp"
+#include "cow_vector.hpp"
+#include <algorithm>
+#include <set>
+#include <numeric>
+#include <string>
+#include <cstdio>
 
 int destroy_counter;
 
@@ -25,6 +44,28 @@ public:
     }
 };
 
+// Records the address of every object alive, so tests can check that a
+// container destroys exactly the objects it no longer holds. Copying throws
+// once tracked_copies_left copies have been made; -1 never throws.
+std::set<const void*> live_objects;
+int tracked_copies_left = -1;
+
+class Tracked {
+public:
+    Tracked() { live_objects.insert(this); }
+    Tracked(const Tracked&) {
+        if (tracked_copies_left == 0) {
+            throw std::runtime_error("Copy failed");
+        }
+        if (tracked_copies_left > 0) {
+            --tracked_copies_left;
+        }
+        live_objects.insert(this);
+    }
+    Tracked& operator=(const Tracked&) { return *this; }
+    ~Tracked() { live_objects.erase(this); }
+};
+
 int copy_counter;
 
 class Exceptional {
@@ -41,6 +82,112 @@ public:
     }
 };
 
+int move_counter;
+
+class Movable {
+public:
+    Movable() {}
+    Movable(const Movable&) {
+        ++copy_counter;
+    }
+    Movable(Movable&&) noexcept {
+        ++move_counter;
+    }
+};
+
+class Handle {
+public:
+    Handle(int value = 0) : value_(new int(value)) {}
+    Handle(const Handle& other) : value_(new int(*other.value_)) {
+        ++copy_counter;
+    }
+    Handle(Handle&& other) noexcept : value_(other.value_) {
+        other.value_ = nullptr;
+        ++move_counter;
+    }
+    Handle& operator=(Handle&& other) noexcept {
+        std::swap(value_, other.value_);
+        ++move_counter;
+        return *this;
+    }
+    ~Handle() {
+        ++destroy_counter;
+        delete value_;
+    }
+    int value() const { return *value_; }
+private:
+    int* value_;
+};
+
+namespace my {
+template <> struct is_trivially_relocatable<Handle> : std::true_type {};
+}
+
+struct Expandable {
+    int value;
+};
+
+struct Cached {
+    int value;
+};
+
+struct alignas(64) Wide {
+    char bytes[64];
+};
+
+// Cached blocks stay allocated in the pool and would block in-place growth
+// that the tests below rely on.
+namespace my {
+template <> struct pool_traits<Destroyable> {
+    static const bool cached = false;
+};
+template <> struct pool_traits<Expandable> {
+    static const bool cached = false;
+};
+}
+
+// A minimal stateful allocator: allocate, deallocate and equality only, so
+// containers have to go through std::allocator_traits for everything else.
+template <class T, bool Propagate>
+struct tagged_allocator {
+    typedef T value_type;
+    typedef std::integral_constant<bool, Propagate> propagate_on_container_copy_assignment;
+    typedef std::integral_constant<bool, Propagate> propagate_on_container_move_assignment;
+    typedef std::integral_constant<bool, Propagate> propagate_on_container_swap;
+    template <class U> struct rebind { typedef tagged_allocator<U, Propagate> other; };
+
+    explicit tagged_allocator(int tag) : tag(tag) {}
+    template <class U> tagged_allocator(const tagged_allocator<U, Propagate>& other) : tag(other.tag) {}
+
+    T* allocate(size_t n) { return std::allocator<T>().allocate(n); }
+    void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+
+    int tag;
+};
+
+template <class T, class U, bool Propagate>
+bool operator==(const tagged_allocator<T, Propagate>& a, const tagged_allocator<U, Propagate>& b) { return a.tag == b.tag; }
+
+template <class T, class U, bool Propagate>
+bool operator!=(const tagged_allocator<T, Propagate>& a, const tagged_allocator<U, Propagate>& b) { return a.tag != b.tag; }
+
+class counting_resource : public my::memory_resource {
+public:
+    counting_resource() : allocations(0), live(0) {}
+    int allocations;
+    int live;
+protected:
+    void* do_allocate(size_t bytes, size_t align) override {
+        ++allocations;
+        ++live;
+        return my::new_delete_memory_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+        --live;
+        my::new_delete_memory_resource()->deallocate(p, bytes, align);
+    }
+};
+
 int main(int argc, char* const argv[]) {
     int flag = _CrtSetDbgFlag(_CRTDBG_REPORT_FLAG);
     flag |= _CRTDBG_LEAK_CHECK_DF;
@@ -109,6 +256,15 @@ TEST_CASE ("Constructors' tests", "[constructors]") {
             ok2 = ok2 && test2[i] == 673;
         }
         REQUIRE(ok2);
+        for (size_t n : { 0, 1000, 1024 }) {
+            vector<int, allocator<int>> source;
+            for (size_t i = 0; i < n; ++i) {
+                source.push_back(static_cast<int>(i));
+            }
+            vector<int, allocator<int>> copy(source);
+            REQUIRE(copy.size() == n);
+            REQUIRE(copy.capacity() == copy.size());
+        }
     }
     SECTION("Move constructor") {
         vector<int, allocator<int>> test(10U, 673);
@@ -613,7 +769,7 @@ TEST_CASE("Memory management") {
             destroy_counter = 0;
             vector<Destroyable, allocator<Destroyable>> a(10);
             a.resize(50);
-            REQUIRE(destroy_counter == 11); //one temp in fill
+            REQUIRE(destroy_counter == 1); //one temp in fill, grown in place
         }
         {
             destroy_counter = 0;
@@ -634,6 +790,13 @@ TEST_CASE("Memory management") {
             vector<Destroyable, allocator<Destroyable>> a(15);
             a.push_back(Destroyable());
             a.push_back(Destroyable());
+            REQUIRE(destroy_counter == 2); //2 temp, grown in place
+        }
+        {
+            destroy_counter = 0;
+            vector<Destroyable> a(15);
+            a.push_back(Destroyable());
+            a.push_back(Destroyable());
             REQUIRE(destroy_counter == 18); //2 temp, 16 are copied
         }
         {
@@ -641,14 +804,14 @@ TEST_CASE("Memory management") {
             vector<Destroyable, allocator<Destroyable>> a(15);
             a.push_back(Destroyable());
             a.insert(a.begin() + 3, Destroyable());
-            REQUIRE(destroy_counter == 18);
+            REQUIRE(destroy_counter == 2);
         }
         {
             destroy_counter = 0;
             vector<Destroyable, allocator<Destroyable>> a(15);
             a.push_back(Destroyable());
             a.insert(a.begin() + 3, { Destroyable(), Destroyable() });
-            REQUIRE(destroy_counter == 21);
+            REQUIRE(destroy_counter == 5);
         }
         {
             destroy_counter = 0;
@@ -673,14 +836,14 @@ TEST_CASE("Memory management") {
             vector<Destroyable, allocator<Destroyable>> a(15);
             a.emplace_back(Destroyable());
             a.emplace(a.begin() + 3, Destroyable());
-            REQUIRE(destroy_counter == 18);
+            REQUIRE(destroy_counter == 2);
         }
         {
             destroy_counter = 0;
             vector<Destroyable, allocator<Destroyable>> a(15);
             a.emplace_back(Destroyable());
             a.emplace_back(Destroyable());
-            REQUIRE(destroy_counter == 18); //2 temp, 16 are copied
+            REQUIRE(destroy_counter == 2); //2 temp, grown in place
         }
     }
 }
@@ -695,6 +858,132 @@ TEST_CASE("Emplace") {
     REQUIRE(a.back() == 12);
 }
 
+TEST_CASE("Growth policies") {
+    SECTION("Power of two") {
+        REQUIRE(power_of_two_growth::next_capacity<int>(0, 0) == 0);
+        REQUIRE(power_of_two_growth::next_capacity<int>(0, 1) == 2);
+        REQUIRE(power_of_two_growth::next_capacity<int>(0, 5) == 8);
+        REQUIRE(power_of_two_growth::next_capacity<int>(0, 8) == 16);
+        REQUIRE(power_of_two_growth::next_capacity<int>(0, 100) == 128);
+        REQUIRE(power_of_two_growth::next_capacity<int>(2048, 1024) == 1024);
+    }
+    SECTION("One and a half") {
+        REQUIRE(one_and_half_growth::next_capacity<int>(0, 3) == 3);
+        REQUIRE(one_and_half_growth::next_capacity<int>(100, 101) == 150);
+        REQUIRE(one_and_half_growth::next_capacity<int>(100, 200) == 200);
+        REQUIRE(one_and_half_growth::next_capacity<int>(100, 10) == 10);
+    }
+    SECTION("Fixed step") {
+        REQUIRE(fixed_step_growth<64>::next_capacity<int>(0, 1) == 64);
+        REQUIRE(fixed_step_growth<64>::next_capacity<int>(64, 65) == 128);
+        REQUIRE(fixed_step_growth<64>::next_capacity<int>(128, 0) == 0);
+        REQUIRE(fixed_step_growth<64>::next_capacity<int>(128, 70) == 70);
+    }
+    SECTION("Size class") {
+        REQUIRE(size_class_growth::next_capacity<int>(0, 1) == 4);
+        REQUIRE(size_class_growth::next_capacity<char>(128, 129) == 192);
+        REQUIRE(size_class_growth::next_capacity<char>(0, 129) == 160);
+        REQUIRE(size_class_growth::next_capacity<char>(192, 129) == 129);
+    }
+    SECTION("Vector with policy") {
+        vector<int, allocator<int>, one_and_half_growth> test;
+        for (int i = 0; i < 1000; ++i) {
+            test.push_back(i);
+        }
+        REQUIRE(test.size() == 1000);
+        REQUIRE(test.capacity() < 1500);
+        bool ok = true;
+        for (int i = 0; i < 1000; ++i) {
+            ok = ok && test[i] == i;
+        }
+        REQUIRE(ok);
+        test.shrink_to_fit();
+        REQUIRE(test.capacity() == 1000);
+        vector<int, allocator<int>, fixed_step_growth<16>> test2(10U, 1);
+        REQUIRE(test2.capacity() == 16);
+        test2.resize(17);
+        REQUIRE(test2.capacity() == 32);
+        vector<int, allocator<int>> test3(1024U, 1);
+        test3.shrink_to_fit();
+        REQUIRE(test3.capacity() == 1024);
+    }
+}
+
+TEST_CASE("Reallocation") {
+    SECTION("Nothrow movable elements are moved") {
+        copy_counter = 0;
+        move_counter = 0;
+        vector<Movable> a(10U);
+        a.reserve(100);
+        REQUIRE(copy_counter == 0);
+        REQUIRE(move_counter == 10);
+        Movable m;
+        a.push_back(std::move(m));
+        REQUIRE(copy_counter == 0);
+        REQUIRE(move_counter == 11);
+    }
+    SECTION("Trivially copyable elements survive shrink") {
+        vector<int, allocator<int>> a = { 0,1,2,3,4,5 };
+        a.reserve(100);
+        a.shrink_to_fit();
+        REQUIRE(a.size() == 6);
+        REQUIRE(a.capacity() < 100);
+        bool ok = true;
+        for (int i = 0; i < 6; ++i) {
+            ok = ok && a[i] == i;
+        }
+        REQUIRE(ok);
+    }
+    SECTION("Elements of the vector itself can be appended") {
+        vector<std::string> v{ "first", "second" };
+        vector<std::string> w(v);
+        w.push_back(w[0]);
+        w.emplace_back(w[1]);
+        w.push_back(std::move(w[0]));
+        REQUIRE(w.size() == 5);
+        REQUIRE(w[2] == "first");
+        REQUIRE(w[3] == "second");
+        REQUIRE(w[4] == "first");
+        vector<int, allocator<int>> a{ 7 };
+        for (int i = 0; i < 100; ++i) {
+            a.push_back(a[i]);
+        }
+        REQUIRE(a[100] == 7);
+    }
+}
+
+TEST_CASE("Trivial relocation") {
+    copy_counter = 0;
+    move_counter = 0;
+    destroy_counter = 0;
+    {
+        vector<Handle, allocator<Handle>> a;
+        for (int i = 0; i < 10; ++i) {
+            a.emplace_back(i);
+        }
+        REQUIRE(move_counter == 0);
+        REQUIRE(destroy_counter == 0);
+        a.emplace(a.begin() + 2, 100);
+        a.insert(a.begin(), Handle(200));
+        REQUIRE(destroy_counter == 1);
+        a.insert(a.begin() + 5, 2U, Handle(300));
+        REQUIRE(copy_counter == 2);
+        REQUIRE(destroy_counter == 2);
+        a.erase(a.begin() + 1);
+        a.erase(a.begin() + 3, a.begin() + 6);
+        REQUIRE(destroy_counter == 6);
+        REQUIRE(move_counter == 1);
+        int r[] = { 200, 1, 100, 3, 4, 5, 6, 7, 8, 9 };
+        REQUIRE(a.size() == 10);
+        bool ok = true;
+        for (int i = 0; i < 10; ++i) {
+            ok = ok && a[i].value() == r[i];
+        }
+        REQUIRE(ok);
+    }
+    REQUIRE(destroy_counter == 16);
+}
+
 TEST_CASE("Exceptions check") {
     copy_counter = 0;
     destroy_counter = 0;
@@ -713,5 +1002,1210 @@ TEST_CASE("Allocator") {
     al_c.destroy(t);
     REQUIRE(destroy_counter == 1);
     al_c.deallocate(t, 1);
-    REQUIRE_THROWS_AS(al_c.allocate(1000000000), std::bad_alloc);
+    REQUIRE_THROWS_AS(al_c.allocate(al_c.max_size()), std::bad_alloc);
+    REQUIRE_THROWS_AS(al_c.allocate(al_c.max_size() + 1), std::bad_alloc);
+}
+
+size_t arena_count() {
+    std::lock_guard<std::mutex> lock(pool().mutex);
+    size_t count = 0;
+    for (auto a = pool().arenas; a != nullptr; a = a->next) {
+        ++count;
+    }
+    return count;
+}
+
+TEST_CASE("Pool growth") {
+    const size_t initial = arena_count();
+    allocator<Expandable> al;
+    vector<Expandable*> blocks;
+    for (size_t i = 0; i < 16384; ++i) {
+        blocks.push_back(al.allocate(1));
+        blocks.back()->value = static_cast<int>(i);
+    }
+    Expandable* big = al.allocate(65536);
+    REQUIRE(arena_count() > initial);
+    bool ok = true;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        ok = ok && blocks[i]->value == static_cast<int>(i);
+    }
+    REQUIRE(ok);
+    for (auto p : blocks) {
+        al.deallocate(p, 1);
+    }
+    al.deallocate(big, 65536);
+    REQUIRE(arena_count() <= initial);
+}
+
+TEST_CASE("Shared pool") {
+    SECTION("Memory is reused across element types") {
+        allocator<Expandable> al_e;
+        allocator<Destroyable> al_d;
+        Expandable* a = al_e.allocate(100);
+        al_e.deallocate(a, 100);
+        Destroyable* b = al_d.allocate(400);
+        REQUIRE(static_cast<void*>(b) == static_cast<void*>(a));
+        al_d.deallocate(b, 400);
+    }
+    SECTION("Over-aligned types") {
+        allocator<Wide> al;
+        allocator<char> al_c;
+        vector<Wide*> blocks;
+        vector<char*> padding;
+        for (size_t i = 0; i < 100; ++i) {
+            padding.push_back(al_c.allocate(1 + i % 7));
+            blocks.push_back(al.allocate(1 + i % 3));
+        }
+        bool ok = true;
+        for (auto p : blocks) {
+            ok = ok && reinterpret_cast<size_t>(p) % alignof(Wide) == 0;
+        }
+        REQUIRE(ok);
+        for (size_t i = 0; i < 100; ++i) {
+            al.deallocate(blocks[i], 1 + i % 3);
+            al_c.deallocate(padding[i], 1 + i % 7);
+        }
+    }
+    SECTION("Large allocations bypass the arenas") {
+        set_large_allocation_threshold(1 << 20);
+        const size_t initial = arena_count();
+        allocator<Wide> al_w;
+        Wide* w = al_w.allocate(65536);
+        REQUIRE(reinterpret_cast<size_t>(w) % alignof(Wide) == 0);
+        vector<int, allocator<int>> v;
+        for (int i = 0; i < 1000000; ++i) {
+            v.push_back(i);
+        }
+        REQUIRE(v[999999] == 999999);
+        REQUIRE(arena_count() == initial);
+        std::thread([&al_w, w]() { al_w.deallocate(w, 65536); }).join();
+        v = vector<int, allocator<int>>();
+        set_large_allocation_threshold(memory_pool::default_large_threshold);
+    }
+    SECTION("Large blocks are remapped instead of copied") {
+        set_large_allocation_threshold(1 << 20);
+        allocator<double> al;
+        double* small = al.allocate(16);
+        REQUIRE(al.reallocate(small, 16, 32) == nullptr);
+        al.deallocate(small, 16);
+        double* big = al.allocate(1 << 18);
+        big[0] = 1;
+        big[(1 << 18) - 1] = 2;
+        double* moved = al.reallocate(big, 1 << 18, 1 << 22);
+#ifdef __linux__
+        REQUIRE(moved != nullptr);
+        REQUIRE(moved[0] == 1);
+        REQUIRE(moved[(1 << 18) - 1] == 2);
+        moved[(1 << 22) - 1] = 3;
+        al.deallocate(moved, 1 << 22);
+#else
+        REQUIRE(moved == nullptr);
+        al.deallocate(big, 1 << 18);
+#endif
+        vector<double, allocator<double>> v;
+        for (int i = 0; i < 1000000; ++i) {
+            v.push_back(i);
+        }
+        REQUIRE(v[999999] == 999999);
+        REQUIRE(v[123456] == 123456);
+        set_large_allocation_threshold(memory_pool::default_large_threshold);
+    }
+}
+
+TEST_CASE("Thread cache") {
+    SECTION("Freed blocks are reused") {
+        allocator<Cached> al;
+        Cached* a = al.allocate(4);
+        al.deallocate(a, 4);
+        Cached* b = al.allocate(4);
+        REQUIRE(a == b);
+        al.deallocate(b, 4);
+    }
+    SECTION("Concurrent use") {
+        const int threads = 4;
+        bool ok[threads];
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([t, &ok]() {
+                ok[t] = true;
+                for (int round = 0; round < 50; ++round) {
+                    vector<vector<Cached, allocator<Cached>>> rows;
+                    for (int i = 0; i < 16; ++i) {
+                        rows.emplace_back();
+                    }
+                    for (int i = 0; i < 500; ++i) {
+                        rows[i % 16].push_back({ t * 1000 + i });
+                    }
+                    for (int i = 0; i < 500; ++i) {
+                        ok[t] = ok[t] && rows[i % 16][i / 16].value == t * 1000 + i;
+                    }
+                }
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        for (int t = 0; t < threads; ++t) {
+            REQUIRE(ok[t]);
+        }
+    }
+    SECTION("Freeing on another thread") {
+        allocator<Cached> al;
+        Cached* a = al.allocate(100);
+        a[99].value = 99;
+        std::thread([&al, a]() { al.deallocate(a, 100); }).join();
+        Cached* b = al.allocate(100);
+        REQUIRE(b == a);
+        Cached* big = al.allocate(10000);
+        std::thread([&al, big]() { al.deallocate(big, 10000); }).join();
+        al.deallocate(b, 100);
+    }
+    SECTION("Producer and consumer threads") {
+        const int count = 20000;
+        std::vector<Cached*> produced(count);
+        std::atomic<int> ready(0);
+        bool ok = true;
+        std::thread producer([&]() {
+            allocator<Cached> al;
+            for (int i = 0; i < count; ++i) {
+                produced[i] = al.allocate(1 + i % 64);
+                produced[i]->value = i;
+                ready.store(i + 1, std::memory_order_release);
+            }
+        });
+        std::thread consumer([&]() {
+            allocator<Cached> al;
+            for (int i = 0; i < count; ++i) {
+                while (ready.load(std::memory_order_acquire) <= i) {
+                    std::this_thread::yield();
+                }
+                ok = ok && produced[i]->value == i;
+                al.deallocate(produced[i], 1 + i % 64);
+            }
+        });
+        producer.join();
+        consumer.join();
+        REQUIRE(ok);
+    }
+}
+
+TEST_CASE("Expansion in place") {
+    SECTION("Allocator") {
+        allocator<Expandable> al;
+        Expandable* a = al.allocate(4);
+        REQUIRE(al.expand_in_place(a, 4, 8));
+        REQUIRE(al.expand_in_place(a, 8, 8));
+        REQUIRE_FALSE(al.expand_in_place(a, 8, 4));
+        Expandable* b = al.allocate(4);
+        REQUIRE(b > a);
+        REQUIRE_FALSE(al.expand_in_place(a, 8, 9));
+        al.deallocate(a, 8);
+        al.deallocate(b, 4);
+    }
+    SECTION("Freed neighbours are merged") {
+        allocator<Expandable> al;
+        Expandable* a = al.allocate(100);
+        Expandable* b = al.allocate(100);
+        Expandable* c = al.allocate(100);
+        al.deallocate(a, 100);
+        al.deallocate(c, 100);
+        al.deallocate(b, 100);
+        Expandable* all = al.allocate(300);
+        REQUIRE(all == a);
+        al.deallocate(all, 300);
+    }
+    SECTION("Vector growth keeps the buffer") {
+        vector<Expandable, allocator<Expandable>> a;
+        a.push_back({ 0 });
+        auto data = a.data();
+        for (int i = 1; i < 1000; ++i) {
+            a.push_back({ i });
+        }
+        REQUIRE(a.data() == data);
+        bool ok = true;
+        for (int i = 0; i < 1000; ++i) {
+            ok = ok && a[i].value == i;
+        }
+        REQUIRE(ok);
+    }
+}
+
+TEST_CASE("Small vector") {
+    SECTION("Elements stay inline up to N") {
+        small_vector<int, 4> a;
+        REQUIRE(a.capacity() == 4);
+        for (int i = 0; i < 4; ++i) {
+            a.push_back(i);
+        }
+        REQUIRE(a.is_inline());
+        a.push_back(4);
+        REQUIRE_FALSE(a.is_inline());
+        REQUIRE(a.capacity() >= 5);
+        bool ok = true;
+        for (int i = 0; i < 5; ++i) {
+            ok = ok && a[i] == i;
+        }
+        REQUIRE(ok);
+        a.erase(a.begin() + 1, a.end());
+        a.shrink_to_fit();
+        REQUIRE(a.is_inline());
+        REQUIRE(a.size() == 1);
+        REQUIRE(a[0] == 0);
+    }
+    SECTION("Insert and erase") {
+        small_vector<int, 4> a = { 1, 2, 5 };
+        a.insert(a.begin() + 2, { 3, 4 });
+        a.emplace(a.begin(), 0);
+        a.insert(a.end(), 2, 6);
+        REQUIRE(a.size() == 8);
+        bool ok = true;
+        for (int i = 0; i < 7; ++i) {
+            ok = ok && a[i] == i;
+        }
+        REQUIRE(ok);
+        a.erase(a.begin());
+        REQUIRE(a.front() == 1);
+        a.pop_back();
+        REQUIRE(a.back() == 6);
+        REQUIRE(a.size() == 6);
+        REQUIRE_THROWS_AS(a.at(6), std::out_of_range);
+    }
+    SECTION("Erase destroys the vacated tail") {
+        {
+            small_vector<Tracked, 4> a;
+            for (int i = 0; i < 6; ++i) {
+                a.emplace_back();
+            }
+            a.erase(a.begin() + 1, a.begin() + 3);
+            REQUIRE(a.size() == 4);
+            REQUIRE(live_objects.size() == 4);
+            bool ok = true;
+            for (size_t i = 0; i < a.size(); ++i) {
+                ok = ok && live_objects.count(&a[i]) == 1;
+            }
+            REQUIRE(ok);
+        }
+        REQUIRE(live_objects.empty());
+    }
+    SECTION("Copy, move and swap") {
+        destroy_counter = 0;
+        {
+            small_vector<Handle, 2> inline_one = { Handle(1) };
+            small_vector<Handle, 2> heap_one = { Handle(2), Handle(3), Handle(4) };
+            small_vector<Handle, 2> copy(heap_one);
+            REQUIRE(copy.size() == 3);
+            REQUIRE(copy[2].value() == 4);
+            inline_one.swap(heap_one);
+            REQUIRE(inline_one.size() == 3);
+            REQUIRE(inline_one[0].value() == 2);
+            REQUIRE(heap_one.size() == 1);
+            REQUIRE(heap_one[0].value() == 1);
+            small_vector<Handle, 2> moved(std::move(heap_one));
+            REQUIRE(heap_one.empty());
+            REQUIRE(moved[0].value() == 1);
+            moved = std::move(inline_one);
+            REQUIRE(moved.size() == 3);
+            REQUIRE(inline_one.is_inline());
+            destroy_counter = 0;
+        }
+        REQUIRE(destroy_counter == 6);
+    }
+    SECTION("Clear returns to inline storage") {
+        small_vector<int, 2> a(10, 7);
+        REQUIRE_FALSE(a.is_inline());
+        a.clear();
+        REQUIRE(a.is_inline());
+        REQUIRE(a.capacity() == 2);
+        a.resize(2);
+        REQUIRE(a[1] == 0);
+    }
+    SECTION("Custom allocator") {
+        small_vector<Cached, 8, allocator<Cached>> a;
+        for (int i = 0; i < 100; ++i) {
+            a.push_back({ i });
+        }
+        REQUIRE(a[99].value == 99);
+    }
+}
+
+TEST_CASE("Static vector") {
+    SECTION("Constant expressions") {
+        constexpr static_vector<int, 4> a = { 1, 2, 3 };
+        static_assert(a.size() == 3 && a[2] == 3 && a.back() == 3, "");
+        constexpr static_vector<int, 4> b(2, 7);
+        static_assert(b.size() == 2 && b.at(1) == 7 && b.capacity() == 4, "");
+        static_assert(std::is_trivially_copyable<static_vector<int, 4>>::value, "");
+        REQUIRE(a.front() == 1);
+    }
+    SECTION("Overflow policies") {
+        static_vector<int, 2> a = { 1, 2 };
+        REQUIRE_THROWS_AS(a.push_back(3), std::length_error);
+        REQUIRE_THROWS_AS(a.insert(a.begin(), 2, 0), std::length_error);
+        REQUIRE(a.size() == 2);
+        static_vector<int, 2, fail_on_overflow> b = { 1 };
+        REQUIRE(b.push_back(2));
+        REQUIRE_FALSE(b.push_back(3));
+        REQUIRE(b.emplace(b.begin(), 0) == nullptr);
+        REQUIRE_FALSE(b.resize(3));
+        REQUIRE_FALSE(b.assign(3, 0));
+        REQUIRE(b.size() == 2);
+        REQUIRE(b[1] == 2);
+        static_vector<int, 2, fail_on_overflow> c = { 1, 2, 3 };
+        REQUIRE(c.size() == 2);
+    }
+    SECTION("Insert and erase") {
+        static_vector<std::string, 8> a = { "a", "d" };
+        a.insert(a.begin() + 1, { "b", "c" });
+        a.emplace(a.begin(), 1, '0');
+        a.insert(a.end(), 2, "e");
+        REQUIRE(a.size() == 7);
+        REQUIRE(a[0] == "0");
+        REQUIRE(a[3] == "c");
+        REQUIRE(a[6] == "e");
+        a.erase(a.begin() + 1, a.begin() + 3);
+        REQUIRE(a.size() == 5);
+        REQUIRE(a[1] == "c");
+        a.erase(a.end() - 1);
+        a.pop_back();
+        REQUIRE(a.back() == "d");
+        REQUIRE_THROWS_AS(a.at(3), std::out_of_range);
+    }
+    SECTION("Element lifetime") {
+        destroy_counter = 0;
+        {
+            static_vector<Handle, 4> a = { Handle(1), Handle(3) };
+            a.insert(a.begin() + 1, Handle(2));
+            REQUIRE(a[1].value() == 2);
+            REQUIRE(a[2].value() == 3);
+            static_vector<Handle, 4> b(a);
+            b.erase(b.begin());
+            a.swap(b);
+            REQUIRE(a.size() == 2);
+            REQUIRE(b.size() == 3);
+            REQUIRE(a[0].value() == 2);
+            destroy_counter = 0;
+        }
+        REQUIRE(destroy_counter == 5);
+    }
+    SECTION("A throwing copy destroys the copied elements") {
+        {
+            typedef static_vector<Tracked, 4> tracked_vector;
+            tracked_vector a(4);
+            tracked_copies_left = 2;
+            REQUIRE_THROWS_AS(tracked_vector b(a), std::runtime_error);
+            tracked_copies_left = -1;
+            REQUIRE(live_objects.size() == 4);
+        }
+        REQUIRE(live_objects.empty());
+    }
+    SECTION("Inserting copies of an element of the vector") {
+        static_vector<std::string, 8> a = { "a", "b", "c" };
+        a.insert(a.begin(), 2, a[1]);
+        REQUIRE(a.size() == 5);
+        REQUIRE(a[0] == "b");
+        REQUIRE(a[1] == "b");
+        REQUIRE(a[2] == "a");
+        REQUIRE(a[3] == "b");
+        REQUIRE(a[4] == "c");
+    }
+}
+
+TEST_CASE("Arena") {
+    SECTION("Bump allocation") {
+        arena a(256);
+        void* x = a.allocate(10, 1);
+        void* y = a.allocate(8, 8);
+        REQUIRE(reinterpret_cast<size_t>(y) % 8 == 0);
+        REQUIRE(static_cast<char*>(y) - static_cast<char*>(x) >= 10);
+        a.deallocate(x, 10);
+        void* z = a.allocate(4, 4);
+        REQUIRE(z > y);
+        a.deallocate(z, 4);
+        REQUIRE(a.allocate(4, 4) == z);
+        void* big = a.allocate(1000, 16);
+        REQUIRE(reinterpret_cast<size_t>(big) % 16 == 0);
+        REQUIRE(a.used() >= 1018);
+        a.reset();
+        REQUIRE(a.used() == 0);
+        REQUIRE(a.allocate(1000, 16) == big);
+    }
+    SECTION("Vectors in an arena") {
+        arena a;
+        arena_allocator<int> al(a);
+        vector<int, arena_allocator<int>> v(al);
+        v.push_back(0);
+        auto data = v.data();
+        for (int i = 1; i < 1000; ++i) {
+            v.push_back(i);
+        }
+        REQUIRE(v.data() == data);
+        REQUIRE(v[999] == 999);
+        REQUIRE(v.get_allocator() == al);
+        vector<vector<int, arena_allocator<int>>> rows;
+        for (int i = 0; i < 10; ++i) {
+            rows.emplace_back(al);
+            rows.back().resize(10, i);
+        }
+        REQUIRE(rows[9][9] == 9);
+        REQUIRE(a.used() >= 1000 * sizeof(int) + 100 * sizeof(int));
+    }
+}
+
+TEST_CASE("Stateful allocators") {
+    typedef tagged_allocator<int, true> propagating;
+    typedef tagged_allocator<int, false> sticky;
+    SECTION("Constructors keep the allocator") {
+        vector<int, sticky> a(3, 7, sticky(1));
+        REQUIRE(a.get_allocator().tag == 1);
+        REQUIRE(a[2] == 7);
+        vector<int, sticky> b(a);
+        REQUIRE(b.get_allocator().tag == 1);
+        vector<int, sticky> c(a, sticky(2));
+        REQUIRE(c.get_allocator().tag == 2);
+        REQUIRE(c[2] == 7);
+        vector<int, sticky> d(std::move(c), sticky(3));
+        REQUIRE(d.get_allocator().tag == 3);
+        REQUIRE(d.size() == 3);
+        vector<int, sticky> e({ 1, 2 }, sticky(4));
+        REQUIRE(e.get_allocator().tag == 4);
+    }
+    SECTION("Propagating allocators follow the contents") {
+        vector<int, propagating> a({ 1, 2, 3 }, propagating(1));
+        vector<int, propagating> b(propagating(2));
+        b = a;
+        REQUIRE(b.get_allocator().tag == 1);
+        vector<int, propagating> c(propagating(3));
+        c = std::move(b);
+        REQUIRE(c.get_allocator().tag == 1);
+        REQUIRE(c.size() == 3);
+        vector<int, propagating> d({ 4 }, propagating(4));
+        d.swap(c);
+        REQUIRE(d.get_allocator().tag == 1);
+        REQUIRE(c.get_allocator().tag == 4);
+        REQUIRE(c[0] == 4);
+    }
+    SECTION("Non-propagating allocators stay put") {
+        vector<int, sticky> a({ 1, 2, 3 }, sticky(1));
+        vector<int, sticky> b(sticky(2));
+        b = a;
+        REQUIRE(b.get_allocator().tag == 2);
+        REQUIRE(b[2] == 3);
+        vector<int, sticky> c(sticky(3));
+        c = std::move(a);
+        REQUIRE(c.get_allocator().tag == 3);
+        REQUIRE(c.size() == 3);
+        REQUIRE(c[0] == 1);
+    }
+    SECTION("Small vector") {
+        small_vector<int, 2, propagating> a(propagating(0));
+        a.assign({ 1, 2, 3 });
+        small_vector<int, 2, propagating> b(propagating(1));
+        b.swap(a);
+        REQUIRE(a.get_allocator().tag == 1);
+        REQUIRE(b.get_allocator().tag == 0);
+        REQUIRE(b[2] == 3);
+        a = std::move(b);
+        REQUIRE(a.get_allocator().tag == 0);
+        REQUIRE(a.size() == 3);
+    }
+}
+
+TEST_CASE("Memory resources") {
+    SECTION("Allocator delegates to its resource") {
+        counting_resource resource;
+        {
+            vector<int, allocator<int>> a(&resource);
+            for (int i = 0; i < 100; ++i) {
+                a.push_back(i);
+            }
+            REQUIRE(a[99] == 99);
+            REQUIRE(resource.allocations > 0);
+            vector<int, allocator<int>> b(a);
+            REQUIRE(b.get_allocator().resource() == pool_memory_resource());
+            REQUIRE(a.get_allocator() != b.get_allocator());
+        }
+        REQUIRE(resource.live == 0);
+    }
+    SECTION("Arena resource") {
+        arena a;
+        arena_resource resource(a);
+        vector<int, allocator<int>> v(&resource);
+        v.push_back(1);
+        auto data = v.data();
+        for (int i = 0; i < 1000; ++i) {
+            v.push_back(i);
+        }
+        REQUIRE(v.data() == data);
+        REQUIRE(a.used() >= 1001 * sizeof(int));
+        REQUIRE(allocator<int>(&resource) == allocator<char>(&resource));
+    }
+    SECTION("Over-aligned requests") {
+        memory_resource* r = new_delete_memory_resource();
+        void* p = r->allocate(100, 256);
+        REQUIRE(reinterpret_cast<size_t>(p) % 256 == 0);
+        r->deallocate(p, 100, 256);
+    }
+}
+
+TEST_CASE("Reserved vector") {
+    SECTION("Growth keeps elements in place") {
+        reserved_vector<int> a;
+        a.push_back(0);
+        int* first = &a[0];
+        for (int i = 1; i < 1000000; ++i) {
+            a.push_back(a.back() + 1);
+        }
+        REQUIRE(&a[0] == first);
+        REQUIRE(a[999999] == 999999);
+        REQUIRE(a.capacity() >= a.size());
+        a.resize(10);
+        a.shrink_to_fit();
+        REQUIRE(a.capacity() < 10000);
+        REQUIRE(a[9] == 9);
+        a.resize(100000, 7);
+        REQUIRE(&a[0] == first);
+        REQUIRE(a[99999] == 7);
+    }
+    SECTION("Reservation limit") {
+        reserved_vector<int> a(100);
+        a.resize(100);
+        REQUIRE(a.capacity() == 100);
+        REQUIRE_THROWS_AS(a.push_back(1), std::length_error);
+        REQUIRE(a.size() == 100);
+    }
+    SECTION("Copy, move and destruction") {
+        destroy_counter = 0;
+        {
+            reserved_vector<Destroyable> a;
+            a.resize(10);
+            reserved_vector<Destroyable> b(a);
+            reserved_vector<Destroyable> c(std::move(a));
+            REQUIRE(a.empty());
+            REQUIRE(c.size() == 10);
+            b = c;
+            c.pop_back();
+        }
+        REQUIRE(destroy_counter == 30);
+        reserved_vector<int> d{ 1, 2, 3 };
+        reserved_vector<int> e;
+        e = std::move(d);
+        REQUIRE(e.size() == 3);
+        REQUIRE(e.at(2) == 3);
+        REQUIRE_THROWS_AS(e.at(3), std::out_of_range);
+    }
+}
+
+TEST_CASE("Mapped vector") {
+    const char* path = "mapped_vector_test.bin";
+    std::remove(path);
+    SECTION("Contents survive reopening") {
+        {
+            mapped_vector<int> a(path);
+            REQUIRE(a.empty());
+            for (int i = 0; i < 100000; ++i) {
+                a.push_back(100000 - i);
+            }
+            std::sort(a.begin(), a.end());
+            a.erase(a.begin());
+            a.insert(a.begin(), 0);
+            a.shrink_to_fit();
+            REQUIRE(a.capacity() == a.size());
+        }
+        mapped_vector<int> b(path);
+        REQUIRE(b.size() == 100000);
+        REQUIRE(b[0] == 0);
+        REQUIRE(b[1] == 2);
+        REQUIRE(b.back() == 100000);
+        REQUIRE(std::is_sorted(b.data(), b.data() + b.size()));
+        b.resize(10);
+        b.push_back(b[9]);
+        REQUIRE(b[10] == 10);
+        mapped_vector<int> c(std::move(b));
+        REQUIRE(c.size() == 11);
+    }
+    SECTION("Element size is checked") {
+        {
+            mapped_vector<int> a(path);
+            a.push_back(1);
+        }
+        REQUIRE_THROWS_AS(mapped_vector<double> b(path), std::runtime_error);
+    }
+    SECTION("A failed resize keeps the mapping") {
+        {
+            mapped_vector<int> a(path);
+            for (int i = 0; i < 100; ++i) {
+                a.push_back(i);
+            }
+            size_t capacity = a.capacity();
+            REQUIRE_THROWS_AS(a.reserve(size_t(1) << 60), std::bad_alloc);
+            REQUIRE(a.size() == 100);
+            REQUIRE(a.capacity() == capacity);
+            REQUIRE(a[99] == 99);
+            a.push_back(100);
+        }
+        mapped_vector<int> b(path);
+        REQUIRE(b.size() == 101);
+        REQUIRE(b.back() == 100);
+    }
+    std::remove(path);
+}
+
+TEST_CASE("Stable vector") {
+    SECTION("Growth keeps elements in place") {
+        stable_vector<int, 16> a;
+        a.push_back(0);
+        int* first = &a[0];
+        for (int i = 1; i < 1000; ++i) {
+            a.push_back(a[i - 1] + 1);
+        }
+        REQUIRE(&a[0] == first);
+        REQUIRE(a.size() == 1000);
+        REQUIRE(a.capacity() == 1008);
+        REQUIRE(a[999] == 999);
+        REQUIRE(a.back() == 999);
+        REQUIRE_THROWS_AS(a.at(1000), std::out_of_range);
+        a.resize(40);
+        a.shrink_to_fit();
+        REQUIRE(a.capacity() == 48);
+        REQUIRE(&a[0] == first);
+    }
+    SECTION("Iterators cross blocks") {
+        stable_vector<int, 4> a;
+        for (int i = 0; i < 10; ++i) {
+            a.push_back(i);
+        }
+        int expected = 0;
+        bool ok = true;
+        for (auto x : a) {
+            ok = ok && x == expected++;
+        }
+        REQUIRE(ok);
+        REQUIRE(expected == 10);
+        REQUIRE(a.end() - a.begin() == 10);
+        REQUIRE(*(a.begin() + 5) == 5);
+        REQUIRE(*(a.end() - 1) == 9);
+        auto it = a.end();
+        --it;
+        --it;
+        REQUIRE(*it == 8);
+        it -= 6;
+        REQUIRE(*it == 2);
+        REQUIRE(it[3] == 5);
+        REQUIRE(a.begin() < it);
+        a.resize(8);
+        REQUIRE(*(a.end() - 1) == 7);
+        REQUIRE(std::accumulate(a.begin(), a.end(), 0) == 28);
+        std::sort(a.begin(), a.end(), [](int x, int y) { return x > y; });
+        REQUIRE(a[0] == 7);
+        REQUIRE(a[7] == 0);
+    }
+    SECTION("Copy, move and destruction") {
+        destroy_counter = 0;
+        {
+            stable_vector<Destroyable, 4> a(10, Destroyable());
+            destroy_counter = 0;
+            stable_vector<Destroyable, 4> b(a);
+            stable_vector<Destroyable, 4> c(std::move(a));
+            REQUIRE(a.empty());
+            b = c;
+            c.pop_back();
+        }
+        REQUIRE(destroy_counter == 30);
+        stable_vector<int> d{ 1, 2, 3 };
+        stable_vector<int> e;
+        e = std::move(d);
+        REQUIRE(e.size() == 3);
+        REQUIRE(e.front() == 1);
+        e.clear();
+        REQUIRE(e.begin() == e.end());
+    }
+    SECTION("Assignment between different memory resources") {
+        counting_resource first;
+        counting_resource second;
+        {
+            stable_vector<int, 16> a{ allocator<int>(&first) };
+            stable_vector<int, 16> b{ allocator<int>(&second) };
+            for (int i = 0; i < 100; ++i) {
+                a.push_back(i);
+                b.push_back(-i);
+            }
+            a = std::move(b);
+            REQUIRE(a.get_allocator().resource() == &first);
+            REQUIRE(a.size() == 100);
+            REQUIRE(a[99] == -99);
+            REQUIRE(b.empty());
+            b.push_back(1);
+            b = a;
+            REQUIRE(b.get_allocator().resource() == &second);
+            REQUIRE(b.size() == 100);
+            REQUIRE(b[50] == -50);
+            stable_vector<int, 16> c{ allocator<int>(&first) };
+            c.push_back(7);
+            c.swap(a);
+            REQUIRE(c.size() == 100);
+            REQUIRE(a.size() == 1);
+        }
+        REQUIRE(first.live == 0);
+        REQUIRE(second.live == 0);
+    }
+}
+
+TEST_CASE("Concurrent vector") {
+    SECTION("Single thread") {
+        concurrent_vector<int> a;
+        REQUIRE(a.push_back(5) == 0);
+        int* first = &a[0];
+        bool ok = true;
+        for (int i = 1; i < 10000; ++i) {
+            ok = ok && a.push_back(i) == static_cast<size_t>(i);
+        }
+        REQUIRE(ok);
+        REQUIRE(&a[0] == first);
+        REQUIRE(a.size() == 10000);
+        REQUIRE(a.grow_by(100, 7) == 10000);
+        REQUIRE(a.size() == 10100);
+        REQUIRE(a[10099] == 7);
+        REQUIRE(a[9999] == 9999);
+        REQUIRE_THROWS_AS(a.at(10100), std::out_of_range);
+        REQUIRE(std::accumulate(a.begin() + 1, a.begin() + 10000, 0ll) == 49995000ll);
+        a.clear();
+        REQUIRE(a.empty());
+    }
+    SECTION("Many writers and a reader") {
+        const int threads = 4;
+        const int per_thread = 20000;
+        concurrent_vector<int> a;
+        std::atomic<bool> done(false);
+        bool reader_ok = true;
+        std::thread reader([&]() {
+            while (!done) {
+                size_t n = a.size();
+                for (size_t i = 0; i < n; i += 97) {
+                    reader_ok = reader_ok && a[i] >= 0 && a[i] < threads * per_thread;
+                }
+            }
+        });
+        std::vector<std::thread> writers;
+        for (int t = 0; t < threads; ++t) {
+            writers.emplace_back([t, &a]() {
+                for (int i = 0; i < per_thread; ++i) {
+                    if (i % 100 == 0) {
+                        a.grow_by(10, t * per_thread + i);
+                    }
+                    a.push_back(t * per_thread + i);
+                }
+            });
+        }
+        for (auto& w : writers) {
+            w.join();
+        }
+        done = true;
+        reader.join();
+        REQUIRE(reader_ok);
+        REQUIRE(a.size() == threads * per_thread + threads * per_thread / 10);
+        std::vector<int> seen(threads * per_thread, 0);
+        for (auto x : a) {
+            ++seen[x];
+        }
+        bool ok = true;
+        for (int i = 0; i < threads * per_thread; ++i) {
+            ok = ok && seen[i] == (i % per_thread % 100 == 0 ? 11 : 1);
+        }
+        REQUIRE(ok);
+    }
+    SECTION("Destruction") {
+        destroy_counter = 0;
+        {
+            concurrent_vector<Destroyable> a;
+            a.grow_by(300);
+        }
+        REQUIRE(destroy_counter == 300);
+    }
+}
+
+TEST_CASE("Structure of arrays") {
+    SECTION("Rows and columns") {
+        soa_vector<int, double, char> a;
+        for (int i = 0; i < 100; ++i) {
+            a.push_back(i, i / 2.0, static_cast<char>('a' + i % 26));
+        }
+        REQUIRE(a.size() == 100);
+        REQUIRE(a.capacity() == 128);
+        REQUIRE(std::get<0>(a[10]) == 10);
+        REQUIRE(std::get<1>(a[10]) == 5.0);
+        REQUIRE(std::get<2>(a.back()) == 'v');
+        std::get<1>(a[3]) = 42;
+        REQUIRE(a.column<1>()[3] == 42);
+        a[4] = std::make_tuple(-1, -2.0, 'z');
+        REQUIRE(a.column<0>()[4] == -1);
+        REQUIRE(a.column<2>()[4] == 'z');
+        auto ints = a.column<0>();
+        REQUIRE(ints.size() == 100);
+        REQUIRE(std::accumulate(ints.begin(), ints.end(), 0) == 4950 - 5);
+        REQUIRE(a.column<1>().data() + 1 == &std::get<1>(a[1]));
+        a.resize(10);
+        a.shrink_to_fit();
+        REQUIRE(a.capacity() == 10);
+        REQUIRE(std::get<0>(a.at(9)) == 9);
+        REQUIRE_THROWS_AS(a.at(10), std::out_of_range);
+    }
+    SECTION("Non-trivial fields") {
+        soa_vector<std::string, vector<int>> a;
+        a.emplace_back("one", vector<int>{ 1 });
+        a.push_back(std::make_tuple(std::string("two"), vector<int>{ 2, 2 }));
+        for (int i = 0; i < 20; ++i) {
+            a.push_back(std::get<0>(a[0]), std::get<1>(a[1]));
+        }
+        REQUIRE(std::get<0>(a[21]) == "one");
+        REQUIRE(std::get<1>(a[21]).size() == 2);
+        soa_vector<std::string, vector<int>> b(a);
+        soa_vector<std::string, vector<int>> c(std::move(a));
+        REQUIRE(a.empty());
+        REQUIRE(std::get<0>(b[1]) == "two");
+        c = b;
+        c.pop_back();
+        REQUIRE(c.size() == 21);
+        b.clear();
+        REQUIRE(b.empty());
+        soa_vector<int, std::string> d{ std::make_tuple(1, std::string("x")) };
+        REQUIRE(std::get<1>(d.front()) == "x");
+    }
+}
+
+TEST_CASE("SIMD kernels") {
+    SECTION("Every kernel set agrees with plain loops") {
+        std::vector<simd::kernels> sets{ { simd::scalar_fill, simd::scalar_copy, simd::scalar_mismatch } };
+#ifdef MY_SIMD_X86
+        sets.push_back({ simd::sse2_fill, simd::sse2_copy, simd::sse2_mismatch });
+        if (simd::cpu_has_avx2()) {
+            sets.push_back({ simd::avx2_fill, simd::avx2_copy, simd::avx2_mismatch });
+        }
+#endif
+        char pattern[32];
+        for (int i = 0; i < 32; ++i) {
+            pattern[i] = static_cast<char>(i * 7 + 1);
+        }
+        bool ok = true;
+        for (auto& k : sets) {
+            for (size_t offset : { 0, 1, 3, 8, 16, 17, 31 }) {
+                for (size_t bytes = 0; bytes < 300; bytes += 7) {
+                    std::vector<char> a(offset + bytes + 1, 'x'), b(offset + bytes + 1, 'y');
+                    k.fill(a.data() + offset, bytes, pattern);
+                    for (size_t i = 0; i < bytes; ++i) {
+                        ok = ok && a[offset + i] == pattern[i % 32];
+                    }
+                    ok = ok && a[offset + bytes] == 'x';
+                    k.copy(b.data() + offset, a.data() + offset, bytes);
+                    ok = ok && b[offset + bytes] == 'y';
+                    ok = ok && k.mismatch(a.data() + offset, b.data() + offset, bytes) == bytes;
+                    for (size_t at = 0; at < bytes; at += 5) {
+                        b[offset + at] ^= 1;
+                        ok = ok && k.mismatch(a.data() + offset, b.data() + offset, bytes) == at;
+                        b[offset + at] ^= 1;
+                    }
+                }
+            }
+            std::vector<char> large(simd::streaming_threshold + 100, 'a'), target(large.size() + 1, 'b');
+            large[large.size() - 1] = 'z';
+            k.copy(target.data() + 1, large.data(), large.size());
+            ok = ok && target[0] == 'b' && k.mismatch(target.data() + 1, large.data(), large.size()) == large.size();
+        }
+        REQUIRE(ok);
+    }
+    SECTION("Vector fill and copy") {
+        vector<int> a(1000, 7);
+        REQUIRE(std::count(a.begin(), a.end(), 7) == 1000);
+        a.resize(1003, -1);
+        REQUIRE(a[1002] == -1);
+        REQUIRE(a[999] == 7);
+        a.insert(a.begin() + 10, 100, 3);
+        REQUIRE(a[9] == 7);
+        REQUIRE(a[10] == 3);
+        REQUIRE(a[109] == 3);
+        REQUIRE(a[110] == 7);
+        a.assign(77, 5);
+        REQUIRE(a.size() == 77);
+        REQUIRE(a[76] == 5);
+        vector<int> b(a);
+        REQUIRE(std::equal(a.begin(), a.end(), b.begin()));
+        vector<std::string> s(40, "text");
+        vector<std::string> t(s);
+        REQUIRE(t[39] == "text");
+        vector<char> c(4096, 'q');
+        c.resize(5000, 'r');
+        REQUIRE(c[4095] == 'q');
+        REQUIRE(c[4096] == 'r');
+        REQUIRE(c[4999] == 'r');
+    }
+    SECTION("Comparisons") {
+        vector<int> a(1000, 1), b(1000, 1);
+        REQUIRE(a == b);
+        REQUIRE_FALSE(a < b);
+        REQUIRE(a <= b);
+        b[700] = 2;
+        REQUIRE(a != b);
+        REQUIRE(a < b);
+        REQUIRE(b > a);
+        a[700] = -5;
+        b[700] = 1;
+        REQUIRE(a < b);
+        b.pop_back();
+        a[700] = 1;
+        REQUIRE(b < a);
+        REQUIRE(a >= b);
+        vector<unsigned> u(100, 0x100), v(100, 0x100);
+        v[50] = 0x001;
+        REQUIRE(v < u);
+        vector<double> d(100, 0.0), e(100, -0.0);
+        REQUIRE(d == e);
+        d[3] = std::numeric_limits<double>::quiet_NaN();
+        REQUIRE(d != d);
+        vector<std::string> s{ "a", "b" }, t{ "a", "c" };
+        REQUIRE(s < t);
+    }
+}
+
+template <class T>
+bool search_kernels_agree(const simd::search_kernels<T>& k) {
+    bool ok = true;
+    for (size_t n = 0; n < 200; n += 13) {
+        std::vector<T> data(n + 1);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<T>(i % 7);
+        }
+        const T* p = data.data() + 1;
+        T wanted[] = { static_cast<T>(5), static_cast<T>(3), static_cast<T>(9) };
+        for (T value : { static_cast<T>(0), static_cast<T>(6), static_cast<T>(9) }) {
+            ok = ok && k.find(p, n, value) == simd::scalar_find(p, n, value);
+            ok = ok && k.count(p, n, value) == simd::scalar_count(p, n, value);
+        }
+        for (size_t j = 1; j <= 3; ++j) {
+            ok = ok && k.find_any(p, n, wanted, j) == simd::scalar_find_any(p, n, wanted, j);
+        }
+    }
+    std::vector<T> large(70000, static_cast<T>(1));
+    large[69999] = static_cast<T>(2);
+    ok = ok && k.count(large.data(), large.size(), static_cast<T>(1)) == 69999;
+    ok = ok && k.find(large.data(), large.size(), static_cast<T>(2)) == 69999;
+    return ok;
+}
+
+template <class T>
+bool search_kernels_agree() {
+    bool ok = search_kernels_agree(simd::search_kernels<T>{ simd::scalar_find<T>, simd::scalar_count<T>, simd::scalar_find_any<T> });
+#ifdef MY_SIMD_X86
+    ok = ok && search_kernels_agree(simd::search_kernels<T>{ simd::sse2_find<T>, simd::sse2_count<T>, simd::sse2_find_any<T> });
+    if (simd::cpu_has_avx2()) {
+        ok = ok && search_kernels_agree(simd::search_kernels<T>{ simd::avx2_find<T>, simd::avx2_count<T>, simd::avx2_find_any<T> });
+    }
+#endif
+    return ok;
+}
+
+TEST_CASE("Vector search") {
+    SECTION("Every kernel set agrees with plain loops") {
+        REQUIRE(search_kernels_agree<signed char>());
+        REQUIRE(search_kernels_agree<unsigned short>());
+        REQUIRE(search_kernels_agree<int>());
+        REQUIRE(search_kernels_agree<uint64_t>());
+        REQUIRE(search_kernels_agree<float>());
+        REQUIRE(search_kernels_agree<double>());
+    }
+    SECTION("Vector helpers") {
+        vector<int> a(1000);
+        std::iota(a.begin(), a.end(), 0);
+        REQUIRE(*find(a, 700) == 700);
+        REQUIRE(find(a, 1000) == a.end());
+        REQUIRE(contains(a, 999));
+        REQUIRE_FALSE(contains(a, -1));
+        a[10] = 700;
+        REQUIRE(find(a, 700) - a.begin() == 10);
+        REQUIRE(count(a, 700) == 2);
+        REQUIRE(find_if_eq_any(a, { 5000, 900, 20 }) - a.begin() == 20);
+        REQUIRE(find_if_eq_any(a, { -1, -2 }) == a.end());
+        vector<uint64_t> b(300, 1ull << 40);
+        b[299] = 1;
+        REQUIRE(count(b, uint64_t(1)) == 1);
+        REQUIRE(count(b, uint64_t(0)) == 0);
+        vector<double> d(100, 0.5);
+        d[60] = -0.0;
+        d[70] = std::numeric_limits<double>::quiet_NaN();
+        REQUIRE(find(d, 0.0) - d.begin() == 60);
+        REQUIRE_FALSE(contains(d, d[70]));
+        vector<std::string> s{ "x", "y", "z" };
+        REQUIRE(*find(s, std::string("y")) == "y");
+        REQUIRE(count(s, std::string("q")) == 0);
+    }
+}
+
+TEST_CASE("Parallel algorithms") {
+    thread_pool pool(4);
+    SECTION("Thread pool") {
+        REQUIRE(pool.size() == 4);
+        vector<int> hits(1000, 0);
+        pool.run(hits.size(), [&](size_t i) { ++hits[i]; });
+        REQUIRE(std::count(hits.begin(), hits.end(), 1) == 1000);
+        std::atomic<int> calls(0);
+        pool.run(3, [&](size_t) {
+            pool.run(10, [&](size_t) { ++calls; });
+        });
+        REQUIRE(calls == 30);
+        REQUIRE_THROWS_AS(pool.run(100, [](size_t i) { if (i == 42) throw std::runtime_error("task"); }), std::runtime_error);
+        pool.run(0, [](size_t) { throw std::runtime_error("never called"); });
+        thread_pool single(1);
+        int sum = 0;
+        single.run(5, [&](size_t i) { sum += static_cast<int>(i); });
+        REQUIRE(sum == 10);
+    }
+    SECTION("Algorithms match the serial ones") {
+        for (size_t n : { 0, 1, 17, 5000, 200000 }) {
+            vector<int> a(n);
+            for (size_t i = 0; i < n; ++i) {
+                a[i] = static_cast<int>((i * 7919) % 10007) - 5000;
+            }
+            std::vector<int> expected(a.begin(), a.end());
+            par::sort(pool, a);
+            std::sort(expected.begin(), expected.end());
+            REQUIRE(std::equal(expected.begin(), expected.end(), a.begin()));
+            par::sort(pool, a, std::greater<int>());
+            REQUIRE(std::is_sorted(a.begin(), a.end(), std::greater<int>()));
+
+            long long total = std::accumulate(expected.begin(), expected.end(), 0ll);
+            vector<long long> wide;
+            par::transform(pool, a, wide, [](int x) { return static_cast<long long>(x); });
+            REQUIRE(wide.size() == n);
+            REQUIRE(par::reduce(pool, wide, 0ll) == total);
+            REQUIRE(par::reduce(pool, wide, 1ll, [](long long x, long long y) { return std::max(x, y); }) ==
+                (n > 0 ? std::max(1ll, static_cast<long long>(expected.back())) : 1));
+
+            vector<long long> prefix;
+            par::inclusive_scan(pool, wide, prefix);
+            std::vector<long long> serial(wide.begin(), wide.end());
+            std::partial_sum(serial.begin(), serial.end(), serial.begin());
+            REQUIRE(std::equal(serial.begin(), serial.end(), prefix.begin()));
+            par::inclusive_scan(pool, wide, wide);
+            REQUIRE(std::equal(serial.begin(), serial.end(), wide.begin()));
+
+            par::for_each(pool, a, [](int& x) { x = 1; });
+            REQUIRE(static_cast<size_t>(std::count(a.begin(), a.end(), 1)) == n);
+        }
+    }
+    SECTION("Default pool") {
+        vector<double> a(100000, 0.5);
+        REQUIRE(par::reduce(a, 0.0) == 50000.0);
+        vector<std::string> words{ "pear", "apple", "fig" };
+        par::sort(words);
+        REQUIRE(words[0] == "apple");
+        REQUIRE(words[2] == "pear");
+    }
+}
+
+TEST_CASE("Copy-on-write vector") {
+    SECTION("Copies share until written") {
+        cow_vector<int> a{ 1, 2, 3 };
+        const cow_vector<int>& ca = a;
+        REQUIRE(a.use_count() == 1);
+        cow_vector<int> b(a);
+        const cow_vector<int>& cb = b;
+        REQUIRE(a.use_count() == 2);
+        REQUIRE(cb.data() == a.cbegin());
+        REQUIRE(cb[2] == 3);
+        REQUIRE(a == b);
+        REQUIRE(a.use_count() == 2);
+        b.push_back(4);
+        REQUIRE(a.use_count() == 1);
+        REQUIRE(b.use_count() == 1);
+        REQUIRE(a.size() == 3);
+        REQUIRE(b.size() == 4);
+        REQUIRE(a != b);
+        cow_vector<int> c;
+        c = a;
+        c[0] = 10;
+        REQUIRE(ca[0] == 1);
+        REQUIRE(c[0] == 10);
+        c = a;
+        c.erase(c.begin() + 1);
+        c.insert(c.cbegin(), 0);
+        REQUIRE(c.size() == 3);
+        REQUIRE(c.front() == 0);
+        REQUIRE(c.back() == 3);
+        REQUIRE(a.size() == 3);
+        REQUIRE_THROWS_AS(c.at(3), std::out_of_range);
+        cow_vector<int> d(a);
+        d.clear();
+        REQUIRE(d.empty());
+        REQUIRE(d.use_count() == 0);
+        REQUIRE(a.use_count() == 1);
+        cow_vector<int> e(std::move(d));
+        e.resize(5, 7);
+        REQUIRE(e.size() == 5);
+        REQUIRE(e[4] == 7);
+    }
+    SECTION("Handed-out references never reach copies") {
+        cow_vector<int> a{ 1, 2, 3 };
+        int& r = a[0];
+        cow_vector<int> b(a);
+        r = 42;
+        const cow_vector<int>& cb = b;
+        REQUIRE(cb[0] == 1);
+        REQUIRE(a.use_count() == 1);
+        REQUIRE(b.use_count() == 1);
+        cow_vector<int> c;
+        c = a;
+        auto it = a.begin();
+        *it = 7;
+        REQUIRE(static_cast<const cow_vector<int>&>(c)[0] == 42);
+        a.clear();
+        a.push_back(5);
+        cow_vector<int> d(a);
+        REQUIRE(a.use_count() == 2);
+        const cow_vector<int>& cd = d;
+        cow_vector<int> e(d);
+        REQUIRE(cd.use_count() == 3);
+        REQUIRE(e == a);
+    }
+    SECTION("Elements are cloned once and destroyed once") {
+        destroy_counter = 0;
+        {
+            cow_vector<Destroyable> a(10, Destroyable());
+            destroy_counter = 0;
+            cow_vector<Destroyable> b(a);
+            cow_vector<Destroyable> c(b);
+            REQUIRE(destroy_counter == 0);
+            c.pop_back();
+            REQUIRE(destroy_counter == 1);
+            REQUIRE(a.use_count() == 2);
+        }
+        REQUIRE(destroy_counter == 20);
+        cow_vector<std::string> s{ "a", "b" };
+        cow_vector<std::string> t(s);
+        t.push_back(t[0]);
+        REQUIRE(t[2] == "a");
+        REQUIRE(s.size() == 2);
+    }
+    SECTION("Copies are read and written from several threads") {
+        cow_vector<int> shared(1000, 1);
+        std::vector<std::thread> threads;
+        std::atomic<int> failures(0);
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&shared, &failures, t] {
+                for (int i = 0; i < 100; ++i) {
+                    cow_vector<int> copy(shared);
+                    const cow_vector<int>& read = copy;
+                    if (std::accumulate(read.begin(), read.end(), 0) != 1000) {
+                        ++failures;
+                    }
+                    copy[0] = t;
+                    if (copy[0] != t || std::accumulate(read.begin(), read.end(), 0) != 999 + t) {
+                        ++failures;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE(failures == 0);
+        REQUIRE(shared.use_count() == 1);
+    }
 }
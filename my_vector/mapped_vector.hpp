@@ -0,0 +1,220 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "growth_policy.hpp"
+#include "os_memory.hpp"
+
+namespace my {
+
+// A vector of trivially copyable elements that lives in a memory-mapped
+// file. The file starts with a small header holding the element count, so
+// reopening it maps the contents back as they were, without reading or
+// parsing anything. Growth extends the file and remaps it, which may move
+// the elements; iterators and pointers are invalidated as in my::vector.
+template <class T, class GrowthPolicy = power_of_two_growth> class mapped_vector {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "mapped_vector elements must be trivially copyable");
+    static_assert(alignof(T) <= 64, "mapped_vector elements must not need more than 64-byte alignment");
+
+    typedef T value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    typedef T* pointer;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    typedef GrowthPolicy growth_policy;
+
+    // Opens path, creating an empty vector if the file is missing or empty.
+    // Throws std::runtime_error if the file cannot be mapped or was written
+    // with a different element size.
+    explicit mapped_vector(const std::string& path);
+    mapped_vector(const mapped_vector&) = delete;
+    mapped_vector(mapped_vector&& x) noexcept;
+
+    mapped_vector& operator=(const mapped_vector&) = delete;
+    mapped_vector& operator=(mapped_vector&& x) noexcept;
+
+    iterator begin() noexcept { return elements_; }
+    iterator end() noexcept { return elements_ + size(); }
+    const_iterator begin() const noexcept { return elements_; }
+    const_iterator end() const noexcept { return elements_ + size(); }
+
+    size_type size() const noexcept { return header_ != nullptr ? static_cast<size_type>(header_->size) : 0; }
+    size_type max_size() const noexcept { return (std::numeric_limits<size_type>::max() / 2 - header_size) / sizeof(T); }
+    size_type capacity() const noexcept { return capacity_; }
+    bool empty() const noexcept { return size() == 0; }
+    void resize(size_type sz) { resize(sz, T()); }
+    void resize(size_type sz, const T& c);
+    void reserve(size_type n) { if (n > capacity_) remap(n); }
+    void shrink_to_fit() { remap(size()); }
+
+    reference operator[](size_type n) { return elements_[n]; }
+    const_reference operator[](size_type n) const { return elements_[n]; }
+    reference at(size_type n);
+    const_reference at(size_type n) const;
+    reference front() { return elements_[0]; }
+    const_reference front() const { return elements_[0]; }
+    reference back() { return elements_[size() - 1]; }
+    const_reference back() const { return elements_[size() - 1]; }
+    pointer data() noexcept { return elements_; }
+    const T* data() const noexcept { return elements_; }
+
+    void push_back(const T& x) { emplace_back(x); }
+    template<class... Args> void emplace_back(Args&&... args);
+    void pop_back() { --header_->size; }
+    iterator insert(iterator position, const T& x);
+    iterator erase(iterator position) { return erase(position, position + 1); }
+    iterator erase(iterator first, iterator last);
+
+    void clear() noexcept { if (header_ != nullptr) header_->size = 0; }
+    // Writes the mapped pages back to the file.
+    void flush();
+private:
+    struct header {
+        uint64_t magic;
+        uint64_t element_size;
+        uint64_t size;
+    };
+
+    static const size_type header_size = 64;
+    static const uint64_t file_magic = 0x726f746365766d6dull;
+
+    os::mapped_file file_;
+    header* header_;
+    pointer elements_;
+    size_type capacity_;
+
+    void attach() noexcept;
+    void remap(size_type n);
+    void grow(size_type n) { if (n > capacity_) remap(GrowthPolicy::template next_capacity<T>(capacity_, n)); }
+};
+
+template <class T, class GrowthPolicy>
+mapped_vector<T, GrowthPolicy>::mapped_vector(const std::string& path) : header_(nullptr), elements_(nullptr), capacity_(0) {
+    if (!file_.open(path.c_str())) {
+        throw std::runtime_error("Cannot map " + path);
+    }
+    if (file_.size() == 0) {
+        if (!file_.resize(header_size)) {
+            throw std::runtime_error("Cannot map " + path);
+        }
+        header* h = static_cast<header*>(file_.data());
+        h->magic = file_magic;
+        h->element_size = sizeof(T);
+        h->size = 0;
+    }
+    const header* h = static_cast<const header*>(file_.data());
+    if (file_.size() < header_size || h->magic != file_magic || h->element_size != sizeof(T) ||
+        h->size > (file_.size() - header_size) / sizeof(T)) {
+        throw std::runtime_error(path + " does not hold a mapped_vector of this type");
+    }
+    attach();
+}
+
+template <class T, class GrowthPolicy>
+mapped_vector<T, GrowthPolicy>::mapped_vector(mapped_vector&& x) noexcept : file_(std::move(x.file_)), header_(x.header_),
+    elements_(x.elements_), capacity_(x.capacity_) {
+    x.header_ = nullptr;
+    x.elements_ = nullptr;
+    x.capacity_ = 0;
+}
+
+template <class T, class GrowthPolicy>
+mapped_vector<T, GrowthPolicy>& mapped_vector<T, GrowthPolicy>::operator=(mapped_vector&& x) noexcept {
+    file_ = std::move(x.file_);
+    attach();
+    x.attach();
+    return *this;
+}
+
+template <class T, class GrowthPolicy>
+void mapped_vector<T, GrowthPolicy>::attach() noexcept {
+    char* base = static_cast<char*>(file_.data());
+    header_ = reinterpret_cast<header*>(base);
+    elements_ = base != nullptr ? reinterpret_cast<pointer>(base + header_size) : nullptr;
+    capacity_ = base != nullptr ? (file_.size() - header_size) / sizeof(T) : 0;
+}
+
+template <class T, class GrowthPolicy>
+void mapped_vector<T, GrowthPolicy>::remap(size_type n) {
+    if (n > max_size()) {
+        throw std::length_error("Too many elements");
+    }
+    if (!file_.resize(header_size + n * sizeof(T))) {
+        attach();
+        throw std::bad_alloc();
+    }
+    attach();
+}
+
+template <class T, class GrowthPolicy>
+void mapped_vector<T, GrowthPolicy>::resize(size_type sz, const T& c) {
+    size_type old_size = size();
+    if (sz > old_size) {
+        T value(c);
+        grow(sz);
+        std::fill(elements_ + old_size, elements_ + sz, value);
+    }
+    header_->size = sz;
+}
+
+template <class T, class GrowthPolicy>
+typename mapped_vector<T, GrowthPolicy>::reference mapped_vector<T, GrowthPolicy>::at(size_type n) {
+    if (n >= size()) {
+        throw std::out_of_range("Out of range");
+    }
+    return elements_[n];
+}
+
+template <class T, class GrowthPolicy>
+typename mapped_vector<T, GrowthPolicy>::const_reference mapped_vector<T, GrowthPolicy>::at(size_type n) const {
+    if (n >= size()) {
+        throw std::out_of_range("Out of range");
+    }
+    return elements_[n];
+}
+
+// The value is built before growing, since remapping may move the element
+// the arguments refer to.
+template <class T, class GrowthPolicy>
+template <class... Args>
+void mapped_vector<T, GrowthPolicy>::emplace_back(Args&&... args) {
+    T value(std::forward<Args>(args)...);
+    grow(size() + 1);
+    elements_[header_->size++] = value;
+}
+
+template <class T, class GrowthPolicy>
+typename mapped_vector<T, GrowthPolicy>::iterator mapped_vector<T, GrowthPolicy>::insert(iterator position, const T& x) {
+    size_type index = position - elements_;
+    T value(x);
+    grow(size() + 1);
+    std::memmove(elements_ + index + 1, elements_ + index, (size() - index) * sizeof(T));
+    elements_[index] = value;
+    ++header_->size;
+    return elements_ + index;
+}
+
+template <class T, class GrowthPolicy>
+typename mapped_vector<T, GrowthPolicy>::iterator mapped_vector<T, GrowthPolicy>::erase(iterator first, iterator last) {
+    std::memmove(first, last, (end() - last) * sizeof(T));
+    header_->size -= last - first;
+    return first;
+}
+
+template <class T, class GrowthPolicy>
+void mapped_vector<T, GrowthPolicy>::flush() {
+    if (!file_.flush()) {
+        throw std::runtime_error("Cannot flush mapped_vector");
+    }
+}
+
+}
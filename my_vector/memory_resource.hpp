@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+namespace my {
+
+// Polymorphic source of raw memory, so allocation strategy can be picked at
+// run time without changing container types. Implementations override the
+// do_ functions; do_expand may grow a block in place and by default refuses.
+class memory_resource {
+public:
+    virtual ~memory_resource() {}
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        return do_allocate(bytes, align);
+    }
+    void deallocate(void* p, size_t bytes, size_t align = alignof(std::max_align_t)) {
+        do_deallocate(p, bytes, align);
+    }
+    bool expand(void* p, size_t old_bytes, size_t new_bytes) {
+        return do_expand(p, old_bytes, new_bytes);
+    }
+    bool is_equal(const memory_resource& other) const noexcept {
+        return do_is_equal(other);
+    }
+
+protected:
+    virtual void* do_allocate(size_t bytes, size_t align) = 0;
+    virtual void do_deallocate(void* p, size_t bytes, size_t align) = 0;
+    virtual bool do_expand(void*, size_t, size_t) { return false; }
+    virtual bool do_is_equal(const memory_resource& other) const noexcept { return this == &other; }
+};
+
+inline bool operator==(const memory_resource& a, const memory_resource& b) noexcept {
+    return &a == &b || a.is_equal(b);
+}
+
+inline bool operator!=(const memory_resource& a, const memory_resource& b) noexcept {
+    return !(a == b);
+}
+
+// Plain ::operator new and ::operator delete. Over-aligned requests are
+// padded by hand and remember the original pointer just below the block.
+class new_delete_resource : public memory_resource {
+protected:
+    void* do_allocate(size_t bytes, size_t align) override {
+        if (align <= alignof(std::max_align_t)) {
+            return ::operator new(bytes);
+        }
+        char* raw = static_cast<char*>(::operator new(bytes + align + sizeof(void*)));
+        char* p = raw + sizeof(void*);
+        p += (align - reinterpret_cast<size_t>(p) % align) % align;
+        reinterpret_cast<void**>(p)[-1] = raw;
+        return p;
+    }
+    void do_deallocate(void* p, size_t, size_t align) override {
+        if (align <= alignof(std::max_align_t)) {
+            ::operator delete(p);
+        }
+        else if (p != nullptr) {
+            ::operator delete(static_cast<void**>(p)[-1]);
+        }
+    }
+    bool do_is_equal(const memory_resource& other) const noexcept override {
+        return dynamic_cast<const new_delete_resource*>(&other) != nullptr;
+    }
+};
+
+inline memory_resource* new_delete_memory_resource() noexcept {
+    static new_delete_resource resource;
+    return &resource;
+}
+
+}
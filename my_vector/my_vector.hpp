@@ -3,11 +3,32 @@
 #include <stdexcept>
 #include <iterator>
 #include <limits>
+#include <cstring>
+#include <type_traits>
+#include <utility>
 #include <xmemory>
+#include "growth_policy.hpp"
+#include "relocation.hpp"
+#include "simd.hpp"
 
 namespace my {
 
-template <class T, class Allocator = std::allocator<T>> class vector {
+template <class Allocator, class = void>
+struct has_expand_in_place : std::false_type {};
+
+template <class Allocator>
+struct has_expand_in_place<Allocator, decltype(std::declval<Allocator&>().expand_in_place(
+    std::declval<typename Allocator::pointer>(), size_t(), size_t()), void())> : std::true_type {};
+
+template <class Allocator, class = void>
+struct has_reallocate : std::false_type {};
+
+template <class Allocator>
+struct has_reallocate<Allocator, decltype(std::declval<Allocator&>().reallocate(
+    std::declval<typename Allocator::pointer>(), size_t(), size_t()), void())> : std::true_type {};
+
+template <class T, class Allocator = std::allocator<T>, class GrowthPolicy = power_of_two_growth> class vector {
+    typedef std::allocator_traits<Allocator> alloc_traits;
 public:
     typedef T value_type;
     typedef value_type& reference;
@@ -16,6 +37,7 @@ public:
     typedef size_t size_type;
     typedef T* pointer;
     typedef Allocator allocator_type;
+    typedef GrowthPolicy growth_policy;
 
     class iterator : public std::iterator<
         std::random_access_iterator_tag, T, ptrdiff_t, T*, T&>
@@ -23,7 +45,7 @@ public:
     public:
         iterator() : pos_(nullptr), container_(nullptr) {};
         iterator(const iterator& other) : pos_(other.pos_), container_(other.container_) {};
-        iterator(vector<T, Allocator>* container, pointer pos) : pos_(pos), container_(container) {}
+        iterator(vector<T, Allocator, GrowthPolicy>* container, pointer pos) : pos_(pos), container_(container) {}
 
         iterator& operator= (const iterator&);
         bool operator== (const iterator& other) { return pos_ == other.pos_; };
@@ -50,35 +72,41 @@ public:
 
         pointer pos_;
     private:
-        vector<T, Allocator>* container_;
+        vector<T, Allocator, GrowthPolicy>* container_;
 
         void add(size_type);
         void substract(size_type);
     };
 
     vector() : elements_(nullptr), size_(0), capacity_(0), allocator_() {};
-    vector(size_type n);
-    vector(size_type n, const T& value);
-    template <class ForwardIterator>
-        vector(ForwardIterator first, ForwardIterator last);
+    explicit vector(const Allocator& alloc) : elements_(nullptr), size_(0), capacity_(0), allocator_(alloc) {};
+    vector(size_type n, const Allocator& alloc = Allocator());
+    vector(size_type n, const T& value, const Allocator& alloc = Allocator());
+    template <class ForwardIterator, class = typename std::enable_if<!std::is_integral<ForwardIterator>::value>::type>
+        vector(ForwardIterator first, ForwardIterator last, const Allocator& alloc = Allocator());
     vector(const vector& x);
+    vector(const vector& x, const Allocator& alloc);
     vector(vector&&) noexcept;
-    vector(std::initializer_list<T>);
+    vector(vector&& x, const Allocator& alloc);
+    vector(std::initializer_list<T>, const Allocator& alloc = Allocator());
     ~vector();
 
     vector& operator=(const vector& x);
-    vector& operator=(vector&& x) noexcept;
+    vector& operator=(vector&& x) noexcept(alloc_traits::propagate_on_container_move_assignment::value || std::is_empty<Allocator>::value);
     vector& operator=(std::initializer_list<T>);
 
-    template <class ForwardIterator> void assign(ForwardIterator first, ForwardIterator last);
+    template <class ForwardIterator, class = typename std::enable_if<!std::is_integral<ForwardIterator>::value>::type>
+        void assign(ForwardIterator first, ForwardIterator last);
     void assign(size_type n, const T& u);
     void assign(std::initializer_list<T>);
 
+    allocator_type get_allocator() const { return allocator_; }
+
     iterator begin() noexcept { return iterator(this, elements_); }
     iterator end() noexcept { return iterator(this, elements_ + size_); }
 
     size_type size() const noexcept { return size_; }
-    size_type max_size() const noexcept { return allocator_.max_size(); }
+    size_type max_size() const noexcept { return alloc_traits::max_size(allocator_); }
     void resize(size_type sz);
     void resize(size_type sz, const T& c);
     size_type capacity() const noexcept { return capacity_; }
@@ -103,7 +131,8 @@ public:
     iterator insert(iterator position, const T& x);
     iterator insert(iterator position, T&& x);
     iterator insert(iterator position, size_type n, const T& x);
-    template <class ForwardIterator> iterator insert(iterator position, ForwardIterator first, ForwardIterator last);
+    template <class ForwardIterator, class = typename std::enable_if<!std::is_integral<ForwardIterator>::value>::type>
+        iterator insert(iterator position, ForwardIterator first, ForwardIterator last);
     iterator insert(iterator position, std::initializer_list<T> il);
     iterator erase(iterator position);
     iterator erase(iterator first, iterator last);
@@ -120,116 +149,235 @@ private:
     allocator_type allocator_;
 
     void allocate(size_type n);
+    template<class... Args> void grow_and_emplace_back(std::true_type, Args&&... args);
+    template<class... Args> void grow_and_emplace_back(std::false_type, Args&&... args);
+    void swap_buffer(vector& other) noexcept;
+    void swap_allocator(vector& other, std::true_type) noexcept { using std::swap; swap(allocator_, other.allocator_); }
+    void swap_allocator(vector& /*other*/, std::false_type) noexcept {}
+    bool expand(size_type new_capacity, std::true_type);
+    bool expand(size_type /*new_capacity*/, std::false_type) { return false; }
+    bool reallocate(size_type new_capacity, std::true_type);
+    bool reallocate(size_type /*new_capacity*/, std::false_type) { return false; }
+    void relocate(pointer first, pointer last, pointer dest, std::true_type);
+    void relocate(pointer first, pointer last, pointer dest, std::false_type);
+    void shift(pointer first, pointer last, pointer dest, std::true_type);
+    void shift(pointer first, pointer last, pointer dest, std::false_type);
 };
 
-template <class T, class Allocator>
-void vector<T, Allocator>::allocate(size_type n) {
-    size_type new_capacity = static_cast<size_type>(std::floor(pow(2, std::floor(std::log2(n)) + 1)));
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::allocate(size_type n) {
+    size_type new_capacity = GrowthPolicy::template next_capacity<T>(capacity_, n);
+    if (new_capacity > capacity_ && (expand(new_capacity, has_expand_in_place<Allocator>()) ||
+        reallocate(new_capacity, std::integral_constant<bool, has_reallocate<Allocator>::value && is_trivially_relocatable<T>::value>()))) {
+        capacity_ = new_capacity;
+        return;
+    }
     T* new_elements = nullptr;
     try {
-        new_elements = allocator_.allocate(new_capacity);
-        if (elements_ != nullptr && n > size_) {
-            std::uninitialized_copy(elements_, elements_ + size_, new_elements);
+        new_elements = alloc_traits::allocate(allocator_, new_capacity);
+        if (elements_ != nullptr) {
+            relocate(elements_, elements_ + size_, new_elements, is_trivially_relocatable<T>());
         }
     }
     catch (std::bad_alloc) {
         throw;
     }
     catch (...) {
-        allocator_.deallocate(new_elements, new_capacity);
+        alloc_traits::deallocate(allocator_, new_elements, new_capacity);
         throw;
     }
-    for (auto i = elements_; i < elements_ + size_; ++i) {
-        allocator_.destroy(i);
-    }
-    allocator_.deallocate(elements_, capacity_);
+    alloc_traits::deallocate(allocator_, elements_, capacity_);
     capacity_ = new_capacity;
     elements_ = new_elements;
 }
 
-template <class T, class Allocator>
-typename vector<T, Allocator>::iterator& vector<T, Allocator>::iterator::operator=(const iterator& other) {
+template <class T, class Allocator, class GrowthPolicy>
+bool vector<T, Allocator, GrowthPolicy>::expand(size_type new_capacity, std::true_type) {
+    return elements_ != nullptr && allocator_.expand_in_place(elements_, capacity_, new_capacity);
+}
+
+// Lets the allocator move the buffer itself, e.g. by remapping its pages.
+template <class T, class Allocator, class GrowthPolicy>
+bool vector<T, Allocator, GrowthPolicy>::reallocate(size_type new_capacity, std::true_type) {
+    if (elements_ == nullptr) {
+        return false;
+    }
+    pointer moved = allocator_.reallocate(elements_, capacity_, new_capacity);
+    if (moved == nullptr) {
+        return false;
+    }
+    elements_ = moved;
+    return true;
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::relocate(pointer first, pointer last, pointer dest, std::true_type) {
+    if (first != last) {
+        std::memcpy(static_cast<void*>(dest), static_cast<const void*>(first), (last - first) * sizeof(T));
+    }
+}
+
+// Moves when T's move constructor cannot throw, copies otherwise, so a throw
+// leaves the source untouched (strong guarantee). Sources are destroyed only
+// once every element has been relocated.
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::relocate(pointer first, pointer last, pointer dest, std::false_type) {
+    pointer current = dest;
+    try {
+        for (auto i = first; i != last; ++i, ++current) {
+            alloc_traits::construct(allocator_, current, std::move_if_noexcept(*i));
+        }
+    }
+    catch (...) {
+        for (; dest != current; ++dest) {
+            alloc_traits::destroy(allocator_, dest);
+        }
+        throw;
+    }
+    for (; first != last; ++first) {
+        alloc_traits::destroy(allocator_, first);
+    }
+}
+
+// Moves [first, last) within the buffer so that it starts at dest.
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::shift(pointer first, pointer last, pointer dest, std::true_type) {
+    if (first != last) {
+        std::memmove(static_cast<void*>(dest), static_cast<const void*>(first), (last - first) * sizeof(T));
+    }
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::shift(pointer first, pointer last, pointer dest, std::false_type) {
+    if (dest > first) {
+        std::move_backward(first, last, dest + (last - first));
+    }
+    else {
+        std::move(first, last, dest);
+    }
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+typename vector<T, Allocator, GrowthPolicy>::iterator& vector<T, Allocator, GrowthPolicy>::iterator::operator=(const iterator& other) {
     auto tmp(other);
     std::swap(pos_, tmp.pos_);
     std::swap(container_, tmp.container_);
     return *this;
 }
 
-template <class T, class Allocator>
-void vector<T, Allocator>::iterator::add(size_type n) {
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::iterator::add(size_type n) {
     pos_ += n;
 }
 
-template <class T, class Allocator>
-void vector<T, Allocator>::iterator::substract(size_type n) {
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::iterator::substract(size_type n) {
     pos_ -= n;
 }
 
-template <class T, class Allocator>
-vector<T, Allocator>::vector(size_type n): elements_(nullptr), size_(0), capacity_(0), allocator_() {
+template <class T, class Allocator, class GrowthPolicy>
+vector<T, Allocator, GrowthPolicy>::vector(size_type n, const Allocator& alloc): elements_(nullptr), size_(0), capacity_(0), allocator_(alloc) {
     allocate(n);
     size_ = n;
 }
 
-template <class T, class Allocator>
-vector<T, Allocator>::vector(size_type n, const T& value): elements_(nullptr), size_(0), capacity_(0), allocator_() {
+template <class T, class Allocator, class GrowthPolicy>
+vector<T, Allocator, GrowthPolicy>::vector(size_type n, const T& value, const Allocator& alloc): elements_(nullptr), size_(0), capacity_(0), allocator_(alloc) {
     allocate(n);
-    std::uninitialized_fill(elements_, elements_ + n, value);
+    simd::uninitialized_fill(elements_, n, value);
     size_ = n;
 }
 
-template <class T, class Allocator>
-template <class ForwardIterator>
-vector<T, Allocator>::vector(ForwardIterator first, ForwardIterator last) : elements_(nullptr), size_(0), capacity_(0), allocator_() {
+template <class T, class Allocator, class GrowthPolicy>
+template <class ForwardIterator, class>
+vector<T, Allocator, GrowthPolicy>::vector(ForwardIterator first, ForwardIterator last, const Allocator& alloc) : elements_(nullptr), size_(0), capacity_(0), allocator_(alloc) {
     allocate(std::distance(first, last));
-    std::uninitialized_copy(first, last, elements_);
+    simd::uninitialized_copy(first, last, elements_);
     size_ = std::distance(first, last);
 }
 
-template <class T, class Allocator>
-vector<T, Allocator>::vector(const vector& x) : elements_(nullptr), size_(0), capacity_(0), allocator_() {
-    allocate(x.capacity_);
-    std::uninitialized_copy(x.elements_, x.elements_ + x.size_, elements_);
+template <class T, class Allocator, class GrowthPolicy>
+vector<T, Allocator, GrowthPolicy>::vector(const vector& x) : vector(x, alloc_traits::select_on_container_copy_construction(x.allocator_)) {}
+
+// A copy gets exactly x.size() elements of capacity; the growth policy only
+// applies once it grows.
+template <class T, class Allocator, class GrowthPolicy>
+vector<T, Allocator, GrowthPolicy>::vector(const vector& x, const Allocator& alloc) : elements_(nullptr), size_(0), capacity_(0), allocator_(alloc) {
+    if (x.size_ == 0) {
+        return;
+    }
+    elements_ = alloc_traits::allocate(allocator_, x.size_);
+    capacity_ = x.size_;
+    try {
+        simd::uninitialized_copy(x.elements_, x.elements_ + x.size_, elements_);
+    }
+    catch (...) {
+        alloc_traits::deallocate(allocator_, elements_, capacity_);
+        throw;
+    }
     size_ = x.size_;
 }
 
-template <class T, class Allocator>
-vector<T, Allocator>::vector(vector&& x) noexcept : elements_(nullptr), size_(0), capacity_(0), allocator_() {
-    swap(x);
+template <class T, class Allocator, class GrowthPolicy>
+vector<T, Allocator, GrowthPolicy>::vector(vector&& x) noexcept : elements_(nullptr), size_(0), capacity_(0), allocator_(x.allocator_) {
+    swap_buffer(x);
+}
+
+// Memory from an unequal allocator cannot be taken over, so the elements are
+// moved one by one instead.
+template <class T, class Allocator, class GrowthPolicy>
+vector<T, Allocator, GrowthPolicy>::vector(vector&& x, const Allocator& alloc) : elements_(nullptr), size_(0), capacity_(0), allocator_(alloc) {
+    if (allocator_ == x.allocator_) {
+        swap_buffer(x);
+    }
+    else {
+        assign(std::make_move_iterator(x.elements_), std::make_move_iterator(x.elements_ + x.size_));
+    }
 }
 
-template <class T, class Allocator>
-vector<T, Allocator>::vector(std::initializer_list<T> l) : elements_(nullptr), size_(0), capacity_(0), allocator_() {
+template <class T, class Allocator, class GrowthPolicy>
+vector<T, Allocator, GrowthPolicy>::vector(std::initializer_list<T> l, const Allocator& alloc) : elements_(nullptr), size_(0), capacity_(0), allocator_(alloc) {
     allocate(l.size());
-    std::uninitialized_copy(l.begin(), l.end(), elements_);
+    simd::uninitialized_copy(l.begin(), l.end(), elements_);
     size_ = l.size();
 }
 
-template <class T, class Allocator>
-vector<T, Allocator>::~vector() {
+template <class T, class Allocator, class GrowthPolicy>
+vector<T, Allocator, GrowthPolicy>::~vector() {
     for (auto i = elements_; i < elements_ + size_; ++i) {
-        allocator_.destroy(i);
+        alloc_traits::destroy(allocator_, i);
     }
-    allocator_.deallocate(elements_, capacity_);
+    alloc_traits::deallocate(allocator_, elements_, capacity_);
 }
 
-template <class T, class Allocator>
-vector<T, Allocator>& vector<T, Allocator>::operator=(const vector& x) {
-    vector<T, Allocator> tmp(x);
-    swap(tmp);
+// The copy is built with the allocator *this ends up with, so the old buffer
+// leaves together with the old allocator.
+template <class T, class Allocator, class GrowthPolicy>
+vector<T, Allocator, GrowthPolicy>& vector<T, Allocator, GrowthPolicy>::operator=(const vector& x) {
+    if (this != &x) {
+        vector<T, Allocator, GrowthPolicy> tmp(x, alloc_traits::propagate_on_container_copy_assignment::value ? x.allocator_ : allocator_);
+        swap_buffer(tmp);
+        swap_allocator(tmp, std::true_type());
+    }
     return *this;
 }
 
-template <class T, class Allocator>
-vector<T, Allocator>& vector<T, Allocator>::operator=(vector&& x) noexcept {
-    swap(x);
+template <class T, class Allocator, class GrowthPolicy>
+vector<T, Allocator, GrowthPolicy>& vector<T, Allocator, GrowthPolicy>::operator=(vector&& x) noexcept(alloc_traits::propagate_on_container_move_assignment::value || std::is_empty<Allocator>::value) {
+    if (alloc_traits::propagate_on_container_move_assignment::value || allocator_ == x.allocator_) {
+        swap_buffer(x);
+        swap_allocator(x, typename alloc_traits::propagate_on_container_move_assignment());
+    }
+    else {
+        assign(std::make_move_iterator(x.elements_), std::make_move_iterator(x.elements_ + x.size_));
+    }
     return *this;
 }
 
-template <class T, class Allocator>
-vector<T, Allocator>& vector<T, Allocator>::operator=(std::initializer_list<T> l) {
+template <class T, class Allocator, class GrowthPolicy>
+vector<T, Allocator, GrowthPolicy>& vector<T, Allocator, GrowthPolicy>::operator=(std::initializer_list<T> l) {
     for (auto i = elements_; i < elements_ + size_; ++i) {
-        allocator_.destroy(i);
+        alloc_traits::destroy(allocator_, i);
     }
     size_ = 0;
     if (l.size() > capacity_) {
@@ -240,250 +388,389 @@ vector<T, Allocator>& vector<T, Allocator>::operator=(std::initializer_list<T> l
     return *this;
 }
 
-template <class T, class Allocator>
-template <class ForwardIterator>
-void vector<T, Allocator>::assign(ForwardIterator first, ForwardIterator last) {
+template <class T, class Allocator, class GrowthPolicy>
+template <class ForwardIterator, class>
+void vector<T, Allocator, GrowthPolicy>::assign(ForwardIterator first, ForwardIterator last) {
     for (auto i = elements_; i < elements_ + size_; ++i) {
-        allocator_.destroy(i);
+        alloc_traits::destroy(allocator_, i);
     }
     size_ = 0;
     size_type new_size = std::distance(first, last);
     if (new_size > capacity_) {
         allocate(new_size);
     }
-    std::uninitialized_copy(first, last, elements_);
+    simd::uninitialized_copy(first, last, elements_);
     size_ = new_size;
 }
 
-template <class T, class Allocator>
-void vector<T, Allocator>::assign(size_type n, const T& u) {
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::assign(size_type n, const T& u) {
     for (auto i = elements_; i < elements_ + size_; ++i) {
-        allocator_.destroy(i);
+        alloc_traits::destroy(allocator_, i);
     }
     size_ = 0;
     if (n > capacity_) {
         allocate(n);
     }
-    std::uninitialized_fill(elements_, elements_ + n, u);
+    simd::uninitialized_fill(elements_, n, u);
     size_ = n;
 }
 
-template <class T, class Allocator>
-void vector<T, Allocator>::assign(std::initializer_list<T> l) {
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::assign(std::initializer_list<T> l) {
     for (auto i = elements_; i < elements_ + size_; ++i) {
-        allocator_.destroy(i);
+        alloc_traits::destroy(allocator_, i);
     }
     size_ = 0;
     size_type new_size = l.size();
     if (new_size > capacity_) {
         allocate(new_size);
     }
-    std::uninitialized_copy(l.begin(), l.end(), elements_);
+    simd::uninitialized_copy(l.begin(), l.end(), elements_);
     size_ = new_size;
 }
 
-template <class T, class Allocator>
-void vector<T, Allocator>::resize(size_type sz) {
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::resize(size_type sz) {
     if (sz <= size_) {
         for (auto i = elements_ + sz; i < elements_ + size_; ++i) {
-            allocator_.destroy(i);
+            alloc_traits::destroy(allocator_, i);
         }
     }
     else {
         if (sz > capacity_) {
             allocate(sz);
         }
-        std::uninitialized_fill(elements_ + size_, elements_ + sz, T());
+        simd::uninitialized_fill(elements_ + size_, sz - size_, T());
     }
     size_ = sz;
 }
 
-template <class T, class Allocator>
-void vector<T, Allocator>::resize(size_type sz, const T& c) {
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::resize(size_type sz, const T& c) {
     if (sz <= size_) {
         for (auto i = elements_ + sz; i < elements_ + size_; ++i) {
-            allocator_.destroy(i);
+            alloc_traits::destroy(allocator_, i);
         }
     }
     else {
         if (sz > capacity_) {
             allocate(sz);
         }
-        std::uninitialized_fill(elements_ + size_, elements_ + sz, c);
+        simd::uninitialized_fill(elements_ + size_, sz - size_, c);
     }
     size_ = sz;
 }
 
-template <class T, class Allocator>
-typename vector<T, Allocator>::const_reference vector<T, Allocator>::at(size_type n) const {
+template <class T, class Allocator, class GrowthPolicy>
+typename vector<T, Allocator, GrowthPolicy>::const_reference vector<T, Allocator, GrowthPolicy>::at(size_type n) const {
     if (n >= size_) {
         throw std::out_of_range("Vector subscript out of range");
     }
     return elements_[n];
 }
 
-template <class T, class Allocator>
-typename vector<T, Allocator>::reference vector<T, Allocator>::at(size_type n) {
+template <class T, class Allocator, class GrowthPolicy>
+typename vector<T, Allocator, GrowthPolicy>::reference vector<T, Allocator, GrowthPolicy>::at(size_type n) {
     if (n >= size_) {
         throw std::out_of_range("Vector subscript out of range");
     }
     return elements_[n];
 }
 
-template <class T, class Allocator>
-void vector<T, Allocator>::push_back(const T& x) {
-    if (size_ + 1 > capacity_) {
-        allocate(size_ + 1);
-    }
-    allocator_.construct(elements_ + (size_++), x);
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::push_back(const T& x) {
+    emplace_back(x);
 }
 
-template <class T, class Allocator>
-void vector<T, Allocator>::push_back(T&& x) {
-    if (size_ + 1 > capacity_) {
-        allocate(size_ + 1);
-    }
-    allocator_.construct(elements_ + (size_++), x);
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::push_back(T&& x) {
+    emplace_back(std::move(x));
 }
 
-template <class T, class Allocator>
-void vector<T, Allocator>::pop_back() {
-    allocator_.destroy(elements_ + (size_--));
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::pop_back() {
+    alloc_traits::destroy(allocator_, elements_ + (size_--));
 }
 
-template <class T, class Allocator>
-typename vector<T, Allocator>::iterator vector<T, Allocator>::insert(iterator position, const T& x) {
+template <class T, class Allocator, class GrowthPolicy>
+typename vector<T, Allocator, GrowthPolicy>::iterator vector<T, Allocator, GrowthPolicy>::insert(iterator position, const T& x) {
     difference_type p = position - begin();
     if (size_ + 1 > capacity_) {
         allocate(size_ + 1);
     }
-    if (elements_ + p < elements_ + size_) {
-        std::move_backward(elements_ + p, elements_ + size_, elements_ + size_ + 1);
+    shift(elements_ + p, elements_ + size_, elements_ + p + 1, is_trivially_relocatable<T>());
+    try {
+        alloc_traits::construct(allocator_, elements_ + p, x);
+    }
+    catch (...) {
+        shift(elements_ + p + 1, elements_ + size_ + 1, elements_ + p, is_trivially_relocatable<T>());
+        throw;
     }
-    allocator_.construct(elements_ + p, x);
     ++size_;
     return begin() + p;
 }
 
-template <class T, class Allocator>
-typename vector<T, Allocator>::iterator vector<T, Allocator>::insert(iterator position, T&& x) {
+template <class T, class Allocator, class GrowthPolicy>
+typename vector<T, Allocator, GrowthPolicy>::iterator vector<T, Allocator, GrowthPolicy>::insert(iterator position, T&& x) {
     difference_type p = position - begin();
     if (size_ + 1 > capacity_) {
         allocate(size_ + 1);
     }
-    if (elements_ + p < elements_ + size_) {
-        std::move_backward(elements_ + p, elements_ + size_, elements_ + size_ + 1);
+    shift(elements_ + p, elements_ + size_, elements_ + p + 1, is_trivially_relocatable<T>());
+    try {
+        alloc_traits::construct(allocator_, elements_ + p, std::move(x));
+    }
+    catch (...) {
+        shift(elements_ + p + 1, elements_ + size_ + 1, elements_ + p, is_trivially_relocatable<T>());
+        throw;
     }
-    allocator_.construct(elements_ + p, x);
     ++size_;
     return begin() + p;
 }
 
-template <class T, class Allocator>
-typename vector<T, Allocator>::iterator vector<T, Allocator>::insert(iterator position, size_type n, const T& x) {
+template <class T, class Allocator, class GrowthPolicy>
+typename vector<T, Allocator, GrowthPolicy>::iterator vector<T, Allocator, GrowthPolicy>::insert(iterator position, size_type n, const T& x) {
     difference_type p = position - begin();
     if (size_ + n > capacity_) {
         allocate(size_ + n);
     }
-    if (elements_ + p < elements_ + size_) {
-        std::move_backward(elements_ + p, elements_ + size_, elements_ + size_ + n);
+    shift(elements_ + p, elements_ + size_, elements_ + p + n, is_trivially_relocatable<T>());
+    try {
+        simd::uninitialized_fill(elements_ + p, n, x);
+    }
+    catch (...) {
+        shift(elements_ + p + n, elements_ + size_ + n, elements_ + p, is_trivially_relocatable<T>());
+        throw;
     }
-    std::uninitialized_fill(elements_ + p, elements_ + p + n, x);
     size_ += n;
     return begin() + p;
 }
 
-template <class T, class Allocator>
-template <class ForwardIterator>
-typename vector<T, Allocator>::iterator vector<T, Allocator>::insert(iterator position, ForwardIterator first, ForwardIterator last) {
+template <class T, class Allocator, class GrowthPolicy>
+template <class ForwardIterator, class>
+typename vector<T, Allocator, GrowthPolicy>::iterator vector<T, Allocator, GrowthPolicy>::insert(iterator position, ForwardIterator first, ForwardIterator last) {
     size_type n = std::distance(first, last);
     difference_type p = position - begin();
     if (size_ + n > capacity_) {
         allocate(size_ + n);
     }
-    if (elements_ + p < elements_ + size_ + 1) {
-        std::move_backward(elements_ + p, elements_ + size_, elements_ + size_ + n);
+    shift(elements_ + p, elements_ + size_, elements_ + p + n, is_trivially_relocatable<T>());
+    try {
+        simd::uninitialized_copy(first, last, elements_ + p);
+    }
+    catch (...) {
+        shift(elements_ + p + n, elements_ + size_ + n, elements_ + p, is_trivially_relocatable<T>());
+        throw;
     }
-    std::uninitialized_copy(first, last, elements_ + p);
     size_ += n;
     return begin() + p;
 }
 
-template <class T, class Allocator>
-typename vector<T, Allocator>::iterator vector<T, Allocator>::insert(iterator position, std::initializer_list<T> il) {
+template <class T, class Allocator, class GrowthPolicy>
+typename vector<T, Allocator, GrowthPolicy>::iterator vector<T, Allocator, GrowthPolicy>::insert(iterator position, std::initializer_list<T> il) {
     size_type n = il.size();
     difference_type p = position - begin();
     if (size_ + n > capacity_) {
         allocate(size_ + n);
     }
-    if (elements_ + p < elements_ + size_) {
-        std::move_backward(elements_ + p, elements_ + size_, elements_ + size_ + n);
+    shift(elements_ + p, elements_ + size_, elements_ + p + n, is_trivially_relocatable<T>());
+    try {
+        simd::uninitialized_copy(il.begin(), il.end(), elements_ + p);
+    }
+    catch (...) {
+        shift(elements_ + p + n, elements_ + size_ + n, elements_ + p, is_trivially_relocatable<T>());
+        throw;
     }
-    std::uninitialized_copy(il.begin(), il.end(), elements_ + p);
     size_ += n;
     return begin() + p;
 }
 
-template <class T, class Allocator>
-typename vector<T, Allocator>::iterator vector<T, Allocator>::erase(iterator position) {
-    allocator_.destroy(position.pos_);
-    std::move(position + 1, end(), position);
+template <class T, class Allocator, class GrowthPolicy>
+typename vector<T, Allocator, GrowthPolicy>::iterator vector<T, Allocator, GrowthPolicy>::erase(iterator position) {
+    alloc_traits::destroy(allocator_, position.pos_);
+    shift(position.pos_ + 1, elements_ + size_, position.pos_, is_trivially_relocatable<T>());
     --size_;
     return position;
 }
 
-template <class T, class Allocator>
-typename vector<T, Allocator>::iterator vector<T, Allocator>::erase(iterator first, iterator last) {
+template <class T, class Allocator, class GrowthPolicy>
+typename vector<T, Allocator, GrowthPolicy>::iterator vector<T, Allocator, GrowthPolicy>::erase(iterator first, iterator last) {
     for (auto i = first.pos_; i != last.pos_; ++i) {
-        allocator_.destroy(i);
+        alloc_traits::destroy(allocator_, i);
     }
     auto d = last - first;
-    std::move(last, end(), first);
+    shift(last.pos_, elements_ + size_, first.pos_, is_trivially_relocatable<T>());
     size_ -= d;
     return first;
 }
 
-template <class T, class Allocator>
+template <class T, class Allocator, class GrowthPolicy>
 template <class ... Args>
-typename vector<T, Allocator>::iterator vector<T, Allocator>::emplace(iterator pos, Args&&... args) {
+typename vector<T, Allocator, GrowthPolicy>::iterator vector<T, Allocator, GrowthPolicy>::emplace(iterator pos, Args&&... args) {
     difference_type p = pos - begin();
     if (size_ + 1 > capacity_) {
         allocate(size_ + 1);
     }
-    if (elements_ + p < elements_ + size_) {
-        std::move_backward(elements_ + p, elements_ + size_, elements_ + size_ + 1);
+    shift(elements_ + p, elements_ + size_, elements_ + p + 1, is_trivially_relocatable<T>());
+    try {
+        alloc_traits::construct(allocator_, elements_ + p, std::forward<Args>(args)...);
+    }
+    catch (...) {
+        shift(elements_ + p + 1, elements_ + size_ + 1, elements_ + p, is_trivially_relocatable<T>());
+        throw;
     }
-    allocator_.construct(elements_ + p, std::forward<Args>(args)...);
     ++size_;
     return begin() + p;
 }
 
-template <class T, class Allocator>
+template <class T, class Allocator, class GrowthPolicy>
 template <class ... Args>
-void vector<T, Allocator>::emplace_back(Args&&... args) {
+void vector<T, Allocator, GrowthPolicy>::emplace_back(Args&&... args) {
     if (size_ + 1 > capacity_) {
+        grow_and_emplace_back(std::integral_constant<bool, has_reallocate<Allocator>::value && is_trivially_relocatable<T>::value>(),
+            std::forward<Args>(args)...);
+        return;
+    }
+    alloc_traits::construct(allocator_, elements_ + size_, std::forward<Args>(args)...);
+    ++size_;
+}
+
+// args may refer to an element of this vector, so the new element is built
+// before the old buffer goes away. The allocator may remap the buffer, which
+// leaves nowhere to build it beforehand, so it is built on the side and
+// relocated in; T is trivially relocatable here.
+template <class T, class Allocator, class GrowthPolicy>
+template <class ... Args>
+void vector<T, Allocator, GrowthPolicy>::grow_and_emplace_back(std::true_type, Args&&... args) {
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    T* value = reinterpret_cast<T*>(&storage);
+    alloc_traits::construct(allocator_, value, std::forward<Args>(args)...);
+    try {
         allocate(size_ + 1);
     }
-    allocator_.construct(elements_ + size_, std::forward<Args>(args)...);
+    catch (...) {
+        alloc_traits::destroy(allocator_, value);
+        throw;
+    }
+    relocate(value, value + 1, elements_ + size_, std::true_type());
     ++size_;
 }
 
-template <class T, class Allocator>
-void vector<T, Allocator>::swap(vector& other) noexcept {
+// Builds the new element in the new buffer, then relocates the old ones.
+template <class T, class Allocator, class GrowthPolicy>
+template <class ... Args>
+void vector<T, Allocator, GrowthPolicy>::grow_and_emplace_back(std::false_type, Args&&... args) {
+    size_type new_capacity = GrowthPolicy::template next_capacity<T>(capacity_, size_ + 1);
+    if (expand(new_capacity, has_expand_in_place<Allocator>())) {
+        capacity_ = new_capacity;
+        alloc_traits::construct(allocator_, elements_ + size_, std::forward<Args>(args)...);
+        ++size_;
+        return;
+    }
+    T* new_elements = alloc_traits::allocate(allocator_, new_capacity);
+    try {
+        alloc_traits::construct(allocator_, new_elements + size_, std::forward<Args>(args)...);
+    }
+    catch (...) {
+        alloc_traits::deallocate(allocator_, new_elements, new_capacity);
+        throw;
+    }
+    if (elements_ != nullptr) {
+        try {
+            relocate(elements_, elements_ + size_, new_elements, is_trivially_relocatable<T>());
+        }
+        catch (...) {
+            alloc_traits::destroy(allocator_, new_elements + size_);
+            alloc_traits::deallocate(allocator_, new_elements, new_capacity);
+            throw;
+        }
+    }
+    alloc_traits::deallocate(allocator_, elements_, capacity_);
+    capacity_ = new_capacity;
+    elements_ = new_elements;
+    ++size_;
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::swap(vector& other) noexcept {
+    swap_buffer(other);
+    swap_allocator(other, typename alloc_traits::propagate_on_container_swap());
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::swap_buffer(vector& other) noexcept {
     std::swap(elements_, other.elements_);
     std::swap(capacity_, other.capacity_);
     std::swap(size_, other.size_);
 }
 
-template <class T, class Allocator>
-void vector<T, Allocator>::clear() noexcept {
+template <class T, class Allocator, class GrowthPolicy>
+void vector<T, Allocator, GrowthPolicy>::clear() noexcept {
     for (auto i = elements_; i < elements_ + size_; ++i) {
-        allocator_.destroy(i);
+        alloc_traits::destroy(allocator_, i);
     }
-    allocator_.deallocate(elements_, capacity_);
+    alloc_traits::deallocate(allocator_, elements_, capacity_);
     elements_ = nullptr;
     size_ = 0;
     capacity_ = 0;
 }
 
+// Element-wise comparisons. Integral, enum and pointer elements are compared
+// as raw bytes with the vector kernels from simd.hpp.
+template <class T, class Allocator, class GrowthPolicy>
+bool operator==(const vector<T, Allocator, GrowthPolicy>& x, const vector<T, Allocator, GrowthPolicy>& y) {
+    return x.size() == y.size() && simd::equal<T>(x.data(), y.data(), x.size());
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+bool operator!=(const vector<T, Allocator, GrowthPolicy>& x, const vector<T, Allocator, GrowthPolicy>& y) {
+    return !(x == y);
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+bool operator<(const vector<T, Allocator, GrowthPolicy>& x, const vector<T, Allocator, GrowthPolicy>& y) {
+    return simd::lexicographical_compare<T>(x.data(), x.size(), y.data(), y.size());
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+bool operator>(const vector<T, Allocator, GrowthPolicy>& x, const vector<T, Allocator, GrowthPolicy>& y) {
+    return y < x;
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+bool operator<=(const vector<T, Allocator, GrowthPolicy>& x, const vector<T, Allocator, GrowthPolicy>& y) {
+    return !(y < x);
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+bool operator>=(const vector<T, Allocator, GrowthPolicy>& x, const vector<T, Allocator, GrowthPolicy>& y) {
+    return !(x < y);
+}
+
+// Searches over a whole vector. Integral elements of up to 8 bytes, float
+// and double are scanned with the vector kernels from simd.hpp; equality is
+// operator== in every case, so NaN is never found.
+template <class T, class Allocator, class GrowthPolicy>
+typename vector<T, Allocator, GrowthPolicy>::iterator find(vector<T, Allocator, GrowthPolicy>& v, const T& value) {
+    return v.begin() + (simd::find<T>(v.data(), v.data() + v.size(), value) - v.data());
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+size_t count(const vector<T, Allocator, GrowthPolicy>& v, const T& value) {
+    return simd::count<T>(v.data(), v.data() + v.size(), value);
+}
+
+template <class T, class Allocator, class GrowthPolicy>
+bool contains(const vector<T, Allocator, GrowthPolicy>& v, const T& value) {
+    return simd::find<T>(v.data(), v.data() + v.size(), value) != v.data() + v.size();
+}
+
+// The first element equal to any of values. Up to eight values are matched
+// in a single pass.
+template <class T, class Allocator, class GrowthPolicy>
+typename vector<T, Allocator, GrowthPolicy>::iterator find_if_eq_any(vector<T, Allocator, GrowthPolicy>& v, std::initializer_list<T> values) {
+    return v.begin() + (simd::find_first_of<T>(v.data(), v.data() + v.size(), values.begin(), values.size()) - v.data());
+}
+
 }
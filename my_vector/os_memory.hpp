@@ -0,0 +1,360 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace my {
+namespace os {
+
+// Thin wrappers over the system's virtual memory calls. Reserved address
+// space is inaccessible until committed; decommitted pages return to the
+// system but the range stays reserved. Failures return nullptr or false.
+
+inline size_t page_size() noexcept {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+inline size_t round_to_pages(size_t bytes) noexcept {
+    static const size_t page = page_size();
+    return (bytes + page - 1) / page * page;
+}
+
+inline void* reserve(size_t bytes) noexcept {
+#ifdef _WIN32
+    return VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void* p = mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return p != MAP_FAILED ? p : nullptr;
+#endif
+}
+
+inline bool commit(void* p, size_t bytes) noexcept {
+#ifdef _WIN32
+    return VirtualAlloc(p, bytes, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    return mprotect(p, bytes, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+inline void decommit(void* p, size_t bytes) noexcept {
+#ifdef _WIN32
+    VirtualFree(p, bytes, MEM_DECOMMIT);
+#else
+    madvise(p, bytes, MADV_DONTNEED);
+    mprotect(p, bytes, PROT_NONE);
+#endif
+}
+
+inline void release(void* p, size_t bytes) noexcept {
+#ifdef _WIN32
+    (void)bytes;
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, bytes);
+#endif
+}
+
+static const size_t huge_page_size = size_t(2) << 20;
+
+#ifndef _WIN32
+// Maps bytes at an address aligned to huge_page_size by over-mapping and
+// trimming both ends.
+inline char* map_aligned(size_t bytes, int protection) noexcept {
+    size_t padded = bytes + huge_page_size;
+    void* p = mmap(nullptr, padded, protection, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return nullptr;
+    }
+    char* base = static_cast<char*>(p);
+    char* aligned = base + (huge_page_size - reinterpret_cast<size_t>(base) % huge_page_size) % huge_page_size;
+    if (aligned != base) {
+        munmap(base, aligned - base);
+    }
+    if (aligned + bytes != base + padded) {
+        munmap(aligned + bytes, base + padded - (aligned + bytes));
+    }
+    return aligned;
+}
+#endif
+
+// Maps committed memory for a large block, aligned to huge_page_size where
+// the system allows, and asks for it to be backed by huge pages. bytes should
+// be a multiple of huge_page_size. Returns nullptr on failure; give the
+// memory back with release().
+inline void* map_huge(size_t bytes) noexcept {
+#ifdef _WIN32
+    size_t large = GetLargePageMinimum();
+    if (large != 0 && bytes % large == 0) {
+        void* p = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (p != nullptr) {
+            return p;
+        }
+    }
+    return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    char* p = map_aligned(bytes, PROT_READ | PROT_WRITE);
+#ifdef MADV_HUGEPAGE
+    if (p != nullptr) {
+        madvise(p, bytes, MADV_HUGEPAGE);
+    }
+#endif
+    return p;
+#endif
+}
+
+// Grows a mapping made by map_huge to new_bytes by moving page table entries
+// rather than copying: in place if the address space behind it is free, or,
+// when may_move is set, to a new huge-page-aligned address. Returns the
+// mapping's address, or nullptr if it could not be grown, in which case the
+// old mapping is untouched. Only Linux has mremap; elsewhere this always
+// fails.
+inline void* remap_huge(void* p, size_t old_bytes, size_t new_bytes, bool may_move) noexcept {
+#ifdef __linux__
+    void* q = mremap(p, old_bytes, new_bytes, 0);
+    if (q != MAP_FAILED) {
+        return q;
+    }
+    if (!may_move) {
+        return nullptr;
+    }
+    char* target = map_aligned(new_bytes, PROT_NONE);
+    if (target == nullptr) {
+        return nullptr;
+    }
+    q = mremap(p, old_bytes, new_bytes, MREMAP_MAYMOVE | MREMAP_FIXED, target);
+    if (q == MAP_FAILED) {
+        munmap(target, new_bytes);
+        return nullptr;
+    }
+    return q;
+#else
+    (void)p;
+    (void)old_bytes;
+    (void)new_bytes;
+    (void)may_move;
+    return nullptr;
+#endif
+}
+
+// A file mapped read-write into memory. resize() changes the file length
+// and remaps it, so data() may move; the contents are kept.
+class mapped_file {
+public:
+    mapped_file() noexcept : data_(nullptr), size_(0), file_(invalid_file()) {}
+    ~mapped_file() { close(); }
+    mapped_file(const mapped_file&) = delete;
+    mapped_file(mapped_file&& x) noexcept : mapped_file() { swap(x); }
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file& operator=(mapped_file&& x) noexcept { close(); swap(x); return *this; }
+
+    // Opens path for reading and writing, creating an empty file if needed,
+    // and maps its current length.
+    bool open(const char* path) noexcept;
+    bool resize(size_t bytes) noexcept;
+    bool flush() noexcept;
+    void close() noexcept;
+
+    bool is_open() const noexcept { return file_ != invalid_file(); }
+    void* data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+
+    void swap(mapped_file& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(file_, other.file_);
+    }
+private:
+#ifdef _WIN32
+    typedef HANDLE handle;
+    static handle invalid_file() noexcept { return INVALID_HANDLE_VALUE; }
+#else
+    typedef int handle;
+    static handle invalid_file() noexcept { return -1; }
+#endif
+
+    void* data_;
+    size_t size_;
+    handle file_;
+
+    bool set_length(size_t bytes) noexcept;
+    void* map_view(size_t bytes) noexcept;
+    void* remap_view(size_t bytes) noexcept;
+    void unmap() noexcept;
+};
+
+// The old view stays mapped until the new one exists, so a failed resize
+// leaves the file mapped as before. A file is shortened only once no view
+// reaches past its new end.
+inline bool mapped_file::resize(size_t bytes) noexcept {
+    size_t old_size = size_;
+    if (bytes > old_size && !set_length(bytes)) {
+        return false;
+    }
+    if (bytes == 0) {
+        unmap();
+    }
+    else {
+        void* p = remap_view(bytes);
+        if (p == nullptr) {
+            if (bytes > old_size) {
+                set_length(old_size);
+            }
+            return false;
+        }
+        data_ = p;
+    }
+    size_ = bytes;
+    return bytes >= old_size || set_length(bytes);
+}
+
+#ifdef _WIN32
+
+inline bool mapped_file::set_length(size_t bytes) noexcept {
+    LARGE_INTEGER length;
+    length.QuadPart = static_cast<LONGLONG>(bytes);
+    return SetFilePointerEx(file_, length, nullptr, FILE_BEGIN) && SetEndOfFile(file_);
+}
+
+inline void* mapped_file::map_view(size_t bytes) noexcept {
+    HANDLE mapping = CreateFileMappingW(file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<unsigned long long>(bytes) >> 32),
+        static_cast<DWORD>(bytes), nullptr);
+    if (mapping == nullptr) {
+        return nullptr;
+    }
+    void* p = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    CloseHandle(mapping);
+    return p;
+}
+
+inline void* mapped_file::remap_view(size_t bytes) noexcept {
+    void* p = map_view(bytes);
+    if (p != nullptr) {
+        unmap();
+    }
+    return p;
+}
+
+inline void mapped_file::unmap() noexcept {
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+        data_ = nullptr;
+    }
+}
+
+inline bool mapped_file::open(const char* path) noexcept {
+    close();
+    file_ = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER length;
+    if (file_ == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_, &length)) {
+        close();
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(length.QuadPart);
+    if (bytes != 0 && (data_ = map_view(bytes)) == nullptr) {
+        close();
+        return false;
+    }
+    size_ = bytes;
+    return true;
+}
+
+inline bool mapped_file::flush() noexcept {
+    return data_ == nullptr || (FlushViewOfFile(data_, size_) && FlushFileBuffers(file_));
+}
+
+inline void mapped_file::close() noexcept {
+    unmap();
+    if (file_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+    }
+    size_ = 0;
+}
+
+#else
+
+inline bool mapped_file::set_length(size_t bytes) noexcept {
+    return ftruncate(file_, static_cast<off_t>(bytes)) == 0;
+}
+
+inline void* mapped_file::map_view(size_t bytes) noexcept {
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file_, 0);
+    return p != MAP_FAILED ? p : nullptr;
+}
+
+inline void* mapped_file::remap_view(size_t bytes) noexcept {
+#ifdef __linux__
+    if (data_ != nullptr) {
+        void* p = mremap(data_, size_, bytes, MREMAP_MAYMOVE);
+        if (p != MAP_FAILED) {
+            return p;
+        }
+    }
+#endif
+    void* p = map_view(bytes);
+    if (p != nullptr) {
+        unmap();
+    }
+    return p;
+}
+
+inline void mapped_file::unmap() noexcept {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+        data_ = nullptr;
+    }
+}
+
+inline bool mapped_file::open(const char* path) noexcept {
+    close();
+    file_ = ::open(path, O_RDWR | O_CREAT, 0644);
+    struct stat info;
+    if (file_ < 0 || fstat(file_, &info) != 0) {
+        close();
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(info.st_size);
+    if (bytes != 0 && (data_ = map_view(bytes)) == nullptr) {
+        close();
+        return false;
+    }
+    size_ = bytes;
+    return true;
+}
+
+inline bool mapped_file::flush() noexcept {
+    return data_ == nullptr || msync(data_, size_, MS_SYNC) == 0;
+}
+
+inline void mapped_file::close() noexcept {
+    unmap();
+    if (file_ >= 0) {
+        ::close(file_);
+        file_ = -1;
+    }
+    size_ = 0;
+}
+
+#endif
+
+}
+}
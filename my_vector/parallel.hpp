@@ -0,0 +1,365 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include "my_vector.hpp"
+
+namespace my {
+
+// A fixed set of worker threads for fork-join loops. run(tasks, f) calls
+// f(i) for every i in [0, tasks) and returns once all calls have finished;
+// the calling thread takes part as one of the size() threads.
+//
+// Each thread starts with a contiguous share of the indices and takes them
+// from the front. A thread whose share runs out steals the back half of
+// another thread's share, so uneven tasks even out without a central queue.
+// The first exception thrown by f is rethrown from run() after the other
+// calls have finished; indices not yet started are skipped. run() called
+// from inside a task runs its loop on the current thread.
+class thread_pool {
+public:
+    explicit thread_pool(size_t threads = std::thread::hardware_concurrency());
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    ~thread_pool();
+
+    size_t size() const noexcept { return slots_; }
+    template <class F> void run(size_t tasks, F&& f);
+private:
+    // Padded so that neighbouring shares never sit in one cache line.
+    struct share {
+        std::mutex mutex;
+        size_t next;
+        size_t end;
+        char padding[64];
+    };
+
+    size_t slots_;
+    std::unique_ptr<share[]> shares_;
+    vector<std::thread> workers_;
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    size_t generation_;
+    size_t running_;
+    bool stopping_;
+    void (*invoke_)(void* f, size_t index);
+    void* function_;
+    std::atomic<bool> failed_;
+    std::exception_ptr error_;
+
+    static bool& inside_task() noexcept {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    template <class F> static void invoke(void* f, size_t index) { (*static_cast<F*>(f))(index); }
+
+    bool take(size_t slot, size_t& index);
+    void work(size_t slot);
+    void worker(size_t slot);
+};
+
+inline thread_pool::thread_pool(size_t threads) : slots_(threads > 0 ? threads : 1), shares_(new share[slots_]),
+    generation_(0), running_(0), stopping_(false), invoke_(nullptr), function_(nullptr), failed_(false) {
+    for (size_t slot = 0; slot < slots_; ++slot) {
+        shares_[slot].next = 0;
+        shares_[slot].end = 0;
+    }
+    workers_.reserve(slots_ - 1);
+    try {
+        for (size_t slot = 1; slot < slots_; ++slot) {
+            workers_.push_back(std::thread(&thread_pool::worker, this, slot));
+        }
+    }
+    catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : workers_) {
+            t.join();
+        }
+        throw;
+    }
+}
+
+inline thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : workers_) {
+        t.join();
+    }
+}
+
+template <class F>
+void thread_pool::run(size_t tasks, F&& f) {
+    if (tasks == 0) {
+        return;
+    }
+    if (tasks == 1 || slots_ == 1 || inside_task()) {
+        for (size_t i = 0; i < tasks; ++i) {
+            f(i);
+        }
+        return;
+    }
+    typedef typename std::remove_reference<F>::type function;
+    std::lock_guard<std::mutex> serial(run_mutex_);
+    for (size_t slot = 0; slot < slots_; ++slot) {
+        shares_[slot].next = tasks * slot / slots_;
+        shares_[slot].end = tasks * (slot + 1) / slots_;
+    }
+    invoke_ = &invoke<function>;
+    function_ = const_cast<void*>(static_cast<const void*>(std::addressof(f)));
+    failed_.store(false);
+    error_ = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++generation_;
+        running_ = slots_ - 1;
+    }
+    wake_.notify_all();
+    work(0);
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return running_ == 0; });
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+// Takes the next index of the thread's own share, or steals the back half of
+// the first non-empty share after it.
+inline bool thread_pool::take(size_t slot, size_t& index) {
+    {
+        share& own = shares_[slot];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.next < own.end) {
+            index = own.next++;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < slots_; ++i) {
+        share& victim = shares_[(slot + i) % slots_];
+        size_t first;
+        size_t last;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.next >= victim.end) {
+                continue;
+            }
+            last = victim.end;
+            first = last - (last - victim.next + 1) / 2;
+            victim.end = first;
+        }
+        share& own = shares_[slot];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.next = first + 1;
+        own.end = last;
+        index = first;
+        return true;
+    }
+    return false;
+}
+
+inline void thread_pool::work(size_t slot) {
+    inside_task() = true;
+    size_t index;
+    while (take(slot, index)) {
+        if (failed_.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        try {
+            invoke_(function_, index);
+        }
+        catch (...) {
+            if (!failed_.exchange(true)) {
+                error_ = std::current_exception();
+            }
+        }
+    }
+    inside_task() = false;
+}
+
+inline void thread_pool::worker(size_t slot) {
+    size_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this, seen] { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+        }
+        work(slot);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--running_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
+
+// The pool used by the my::par algorithms unless one is passed in, with one
+// thread per hardware thread.
+inline thread_pool& default_thread_pool() {
+    static thread_pool pool;
+    return pool;
+}
+
+namespace par {
+
+// Splits n elements starting at data into ranges for a pool: whole cache
+// lines each, about four per thread so stealing can even out the load, and
+// at least 16KB so a task is worth handing over. Range boundaries fall on
+// cache line boundaries of the buffer, so no two tasks write to one line.
+template <class T>
+class chunks {
+public:
+    chunks(const thread_pool& pool, const T* data, size_t n) : n_(n) {
+        const size_t line = sizeof(T) < 64 ? 64 / sizeof(T) : 1;
+        size_t size = std::max(n / (4 * pool.size()) + 1, 16384 / sizeof(T) + 1);
+        size_ = (size + line - 1) / line * line;
+        uintptr_t address = reinterpret_cast<uintptr_t>(data);
+        head_ = 64 % sizeof(T) == 0 && address % sizeof(T) == 0 ? (64 - address % 64) % 64 / sizeof(T) : 0;
+        count_ = n > head_ ? (n - head_ + size_ - 1) / size_ : 1;
+    }
+
+    size_t count() const noexcept { return count_; }
+    size_t begin(size_t k) const noexcept { return k == 0 ? 0 : k >= count_ ? n_ : head_ + k * size_; }
+    size_t end(size_t k) const noexcept { return begin(k + 1); }
+private:
+    size_t n_;
+    size_t size_;
+    size_t head_;
+    size_t count_;
+};
+
+template <class T, class Allocator, class GrowthPolicy, class F>
+void for_each(thread_pool& pool, vector<T, Allocator, GrowthPolicy>& v, F f) {
+    T* data = v.data();
+    chunks<T> split(pool, data, v.size());
+    pool.run(split.count(), [&](size_t k) {
+        std::for_each(data + split.begin(k), data + split.end(k), f);
+    });
+}
+
+// Resizes out to the size of in and sets out[i] = op(in[i]).
+template <class T, class A1, class G1, class U, class A2, class G2, class UnaryOperation>
+void transform(thread_pool& pool, const vector<T, A1, G1>& in, vector<U, A2, G2>& out, UnaryOperation op) {
+    out.resize(in.size());
+    const T* source = in.data();
+    U* data = out.data();
+    chunks<U> split(pool, data, out.size());
+    pool.run(split.count(), [&](size_t k) {
+        std::transform(source + split.begin(k), source + split.end(k), data + split.begin(k), op);
+    });
+}
+
+// Each range is folded from its first element and the partial results are
+// combined in order, so op only needs to be associative.
+template <class T, class Allocator, class GrowthPolicy, class BinaryOperation = std::plus<T>>
+T reduce(thread_pool& pool, const vector<T, Allocator, GrowthPolicy>& v, T init, BinaryOperation op = BinaryOperation()) {
+    if (v.size() == 0) {
+        return init;
+    }
+    const T* data = v.data();
+    chunks<T> split(pool, data, v.size());
+    vector<T> partial(split.count(), init);
+    pool.run(split.count(), [&](size_t k) {
+        const T* first = data + split.begin(k);
+        partial[k] = std::accumulate(first + 1, data + split.end(k), *first, op);
+    });
+    for (size_t k = 0; k < split.count(); ++k) {
+        init = op(init, partial[k]);
+    }
+    return init;
+}
+
+// Two passes: every range is scanned on its own, then all but the first are
+// offset by the combined totals of the ranges before them. in and out may be
+// the same vector.
+template <class T, class A1, class G1, class A2, class G2, class BinaryOperation = std::plus<T>>
+void inclusive_scan(thread_pool& pool, const vector<T, A1, G1>& in, vector<T, A2, G2>& out, BinaryOperation op = BinaryOperation()) {
+    size_t n = in.size();
+    out.resize(n);
+    if (n == 0) {
+        return;
+    }
+    const T* source = in.data();
+    T* data = out.data();
+    chunks<T> split(pool, data, n);
+    pool.run(split.count(), [&](size_t k) {
+        std::partial_sum(source + split.begin(k), source + split.end(k), data + split.begin(k), op);
+    });
+    vector<T> carry;
+    carry.reserve(split.count());
+    carry.push_back(data[split.end(0) - 1]);
+    for (size_t k = 1; k + 1 < split.count(); ++k) {
+        carry.push_back(op(carry.back(), data[split.end(k) - 1]));
+    }
+    pool.run(split.count() - 1, [&](size_t j) {
+        const T offset = carry[j];
+        T* first = data + split.begin(j + 1);
+        std::transform(first, data + split.end(j + 1), first, [&](const T& x) { return op(offset, x); });
+    });
+}
+
+// Sorts every range on its own, then merges neighbouring runs pairwise, with
+// the merges of each round running in parallel. Not stable.
+template <class T, class Allocator, class GrowthPolicy, class Compare = std::less<T>>
+void sort(thread_pool& pool, vector<T, Allocator, GrowthPolicy>& v, Compare comp = Compare()) {
+    T* data = v.data();
+    chunks<T> split(pool, data, v.size());
+    size_t runs = split.count();
+    pool.run(runs, [&](size_t k) {
+        std::sort(data + split.begin(k), data + split.end(k), comp);
+    });
+    for (size_t width = 1; width < runs; width *= 2) {
+        pool.run((runs + 2 * width - 1) / (2 * width), [&](size_t j) {
+            size_t first = 2 * j * width;
+            size_t middle = std::min(first + width, runs);
+            size_t last = std::min(first + 2 * width, runs);
+            std::inplace_merge(data + split.begin(first), data + split.begin(middle), data + split.begin(last), comp);
+        });
+    }
+}
+
+template <class T, class Allocator, class GrowthPolicy, class F>
+void for_each(vector<T, Allocator, GrowthPolicy>& v, F f) {
+    par::for_each(default_thread_pool(), v, f);
+}
+
+template <class T, class A1, class G1, class U, class A2, class G2, class UnaryOperation>
+void transform(const vector<T, A1, G1>& in, vector<U, A2, G2>& out, UnaryOperation op) {
+    par::transform(default_thread_pool(), in, out, op);
+}
+
+template <class T, class Allocator, class GrowthPolicy, class BinaryOperation = std::plus<T>>
+T reduce(const vector<T, Allocator, GrowthPolicy>& v, T init, BinaryOperation op = BinaryOperation()) {
+    return par::reduce(default_thread_pool(), v, init, op);
+}
+
+template <class T, class A1, class G1, class A2, class G2, class BinaryOperation = std::plus<T>>
+void inclusive_scan(const vector<T, A1, G1>& in, vector<T, A2, G2>& out, BinaryOperation op = BinaryOperation()) {
+    par::inclusive_scan(default_thread_pool(), in, out, op);
+}
+
+template <class T, class Allocator, class GrowthPolicy, class Compare = std::less<T>>
+void sort(vector<T, Allocator, GrowthPolicy>& v, Compare comp = Compare()) {
+    par::sort(default_thread_pool(), v, comp);
+}
+
+}
+}
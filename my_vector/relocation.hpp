@@ -0,0 +1,16 @@
+#pragma once
+#include <type_traits>
+
+namespace my {
+
+// A type is trivially relocatable when moving an object to a new address and
+// ending the lifetime of the original is equivalent to copying its bytes.
+// Containers then shift such elements with memmove and skip the
+// move-construct/destroy pairs. Specialize this for types that own
+// resources through plain pointers, e.g.
+//
+//     template <> struct is_trivially_relocatable<handle> : std::true_type {};
+template <class T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+}
@@ -0,0 +1,238 @@
+#pragma once
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <initializer_list>
+#include "os_memory.hpp"
+
+namespace my {
+
+// An append-oriented vector that reserves address space for max_size()
+// elements up front and commits pages as it grows. Growth never moves the
+// elements, so pointers and references stay valid until the element is
+// removed, and there is no copy and no moment when old and new buffers
+// coexist. shrink_to_fit() gives the unused pages back to the system.
+// Nothing is reserved until the first element or reserve() call.
+template <class T> class reserved_vector {
+public:
+    typedef T value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    typedef T* pointer;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    static const size_type default_reservation = size_type(1) << (sizeof(size_type) >= 8 ? 36 : 28);
+
+    reserved_vector() noexcept : reserved_vector(default_reservation / sizeof(T)) {}
+    // Sets max_size() to max_elements; the address space is taken lazily.
+    explicit reserved_vector(size_type max_elements) noexcept;
+    reserved_vector(std::initializer_list<T>);
+    reserved_vector(const reserved_vector& x);
+    reserved_vector(reserved_vector&& x) noexcept;
+    ~reserved_vector();
+
+    reserved_vector& operator=(const reserved_vector& x);
+    reserved_vector& operator=(reserved_vector&& x) noexcept;
+
+    iterator begin() noexcept { return elements_; }
+    iterator end() noexcept { return elements_ + size_; }
+    const_iterator begin() const noexcept { return elements_; }
+    const_iterator end() const noexcept { return elements_ + size_; }
+
+    size_type size() const noexcept { return size_; }
+    size_type max_size() const noexcept { return max_size_; }
+    size_type capacity() const noexcept { return std::min(committed_ / sizeof(T), max_size_); }
+    bool empty() const noexcept { return size_ == 0; }
+    void resize(size_type sz);
+    void resize(size_type sz, const T& c);
+    void reserve(size_type n) { if (n > capacity()) commit(n); }
+    void shrink_to_fit() noexcept;
+
+    reference operator[](size_type n) { return elements_[n]; }
+    const_reference operator[](size_type n) const { return elements_[n]; }
+    reference at(size_type n);
+    const_reference at(size_type n) const;
+    reference front() { return elements_[0]; }
+    const_reference front() const { return elements_[0]; }
+    reference back() { return elements_[size_ - 1]; }
+    const_reference back() const { return elements_[size_ - 1]; }
+    pointer data() noexcept { return elements_; }
+    const T* data() const noexcept { return elements_; }
+
+    void push_back(const T& x) { emplace_back(x); }
+    void push_back(T&& x) { emplace_back(std::move(x)); }
+    template<class... Args> void emplace_back(Args&&... args);
+    void pop_back();
+
+    void swap(reserved_vector&) noexcept;
+    void clear() noexcept;
+private:
+    pointer elements_;
+    size_type size_;
+    size_type committed_;
+    size_type max_size_;
+
+    static const size_type min_commit = 64 * 1024;
+
+    size_type reserved_bytes() const noexcept { return os::round_to_pages(max_size_ * sizeof(T)); }
+    void commit(size_type n);
+    void destroy(size_type from) noexcept;
+};
+
+template <class T>
+reserved_vector<T>::reserved_vector(size_type max_elements) noexcept : elements_(nullptr), size_(0), committed_(0),
+    max_size_(std::min(max_elements, (std::numeric_limits<size_type>::max() / 2) / sizeof(T))) {}
+
+template <class T>
+reserved_vector<T>::reserved_vector(std::initializer_list<T> il) : reserved_vector() {
+    reserve(il.size());
+    for (auto& x : il) {
+        emplace_back(x);
+    }
+}
+
+template <class T>
+reserved_vector<T>::reserved_vector(const reserved_vector& x) : reserved_vector(x.max_size_) {
+    reserve(x.size_);
+    for (auto& e : x) {
+        emplace_back(e);
+    }
+}
+
+template <class T>
+reserved_vector<T>::reserved_vector(reserved_vector&& x) noexcept : elements_(x.elements_), size_(x.size_),
+    committed_(x.committed_), max_size_(x.max_size_) {
+    x.elements_ = nullptr;
+    x.size_ = 0;
+    x.committed_ = 0;
+}
+
+template <class T>
+reserved_vector<T>::~reserved_vector() {
+    destroy(0);
+    if (elements_ != nullptr) {
+        os::release(elements_, reserved_bytes());
+    }
+}
+
+template <class T>
+reserved_vector<T>& reserved_vector<T>::operator=(const reserved_vector& x) {
+    if (this != &x) {
+        reserved_vector tmp(x);
+        swap(tmp);
+    }
+    return *this;
+}
+
+template <class T>
+reserved_vector<T>& reserved_vector<T>::operator=(reserved_vector&& x) noexcept {
+    reserved_vector tmp(std::move(x));
+    swap(tmp);
+    return *this;
+}
+
+template <class T>
+void reserved_vector<T>::commit(size_type n) {
+    if (n > max_size_) {
+        throw std::length_error("reserved_vector reservation exceeded");
+    }
+    if (elements_ == nullptr) {
+        elements_ = static_cast<pointer>(os::reserve(reserved_bytes()));
+        if (elements_ == nullptr) {
+            throw std::bad_alloc();
+        }
+    }
+    size_type step = committed_ > min_commit / 2 ? committed_ * 2 : min_commit;
+    size_type bytes = std::min(std::max(os::round_to_pages(n * sizeof(T)), step), reserved_bytes());
+    if (!os::commit(reinterpret_cast<char*>(elements_) + committed_, bytes - committed_)) {
+        throw std::bad_alloc();
+    }
+    committed_ = bytes;
+}
+
+template <class T>
+void reserved_vector<T>::shrink_to_fit() noexcept {
+    size_type bytes = os::round_to_pages(size_ * sizeof(T));
+    if (bytes < committed_) {
+        os::decommit(reinterpret_cast<char*>(elements_) + bytes, committed_ - bytes);
+        committed_ = bytes;
+    }
+}
+
+template <class T>
+void reserved_vector<T>::destroy(size_type from) noexcept {
+    while (size_ > from) {
+        elements_[--size_].~T();
+    }
+}
+
+template <class T>
+void reserved_vector<T>::resize(size_type sz) {
+    reserve(sz);
+    while (size_ < sz) {
+        emplace_back();
+    }
+    destroy(sz);
+}
+
+template <class T>
+void reserved_vector<T>::resize(size_type sz, const T& c) {
+    reserve(sz);
+    while (size_ < sz) {
+        emplace_back(c);
+    }
+    destroy(sz);
+}
+
+template <class T>
+typename reserved_vector<T>::reference reserved_vector<T>::at(size_type n) {
+    if (n >= size_) {
+        throw std::out_of_range("Out of range");
+    }
+    return elements_[n];
+}
+
+template <class T>
+typename reserved_vector<T>::const_reference reserved_vector<T>::at(size_type n) const {
+    if (n >= size_) {
+        throw std::out_of_range("Out of range");
+    }
+    return elements_[n];
+}
+
+// Committing never moves the elements, so args may refer into the vector.
+template <class T>
+template <class... Args>
+void reserved_vector<T>::emplace_back(Args&&... args) {
+    if (size_ == capacity()) {
+        commit(size_ + 1);
+    }
+    ::new (static_cast<void*>(elements_ + size_)) T(std::forward<Args>(args)...);
+    ++size_;
+}
+
+template <class T>
+void reserved_vector<T>::pop_back() {
+    elements_[--size_].~T();
+}
+
+template <class T>
+void reserved_vector<T>::swap(reserved_vector& other) noexcept {
+    std::swap(elements_, other.elements_);
+    std::swap(size_, other.size_);
+    std::swap(committed_, other.committed_);
+    std::swap(max_size_, other.max_size_);
+}
+
+template <class T>
+void reserved_vector<T>::clear() noexcept {
+    destroy(0);
+}
+
+}
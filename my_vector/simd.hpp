@@ -0,0 +1,690 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MY_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(MY_SIMD_X86) && !defined(_MSC_VER)
+#define MY_SIMD_AVX2 __attribute__((target("avx2")))
+#else
+#define MY_SIMD_AVX2
+#endif
+
+namespace my {
+namespace simd {
+
+// Byte kernels behind the typed helpers below. One implementation is picked
+// on first use: AVX2 if the CPU and OS support it, SSE2 on any other x86, and
+// plain loops elsewhere. Short ranges skip the dispatch.
+
+struct kernels {
+    void (*fill)(void* dst, size_t bytes, const void* pattern);
+    void (*copy)(void* dst, const void* src, size_t bytes);
+    size_t (*mismatch)(const void* a, const void* b, size_t bytes);
+};
+
+// Copies this large bypass the cache: the destination would evict the source
+// before either is used again.
+static const size_t streaming_threshold = 4 << 20;
+
+// fill repeats a 32-byte pattern over dst; mismatch returns the offset of the
+// first differing byte, or bytes if there is none.
+inline void scalar_fill(void* dst, size_t bytes, const void* pattern) {
+    char* d = static_cast<char*>(dst);
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        std::memcpy(d + i, pattern, 32);
+    }
+    std::memcpy(d + i, pattern, bytes - i);
+}
+
+inline void scalar_copy(void* dst, const void* src, size_t bytes) {
+    std::memcpy(dst, src, bytes);
+}
+
+inline size_t scalar_mismatch(const void* a, const void* b, size_t bytes) {
+    const unsigned char* x = static_cast<const unsigned char*>(a);
+    const unsigned char* y = static_cast<const unsigned char*>(b);
+    size_t i = 0;
+    while (i < bytes && x[i] == y[i]) {
+        ++i;
+    }
+    return i;
+}
+
+#ifdef MY_SIMD_X86
+
+inline unsigned lowest_bit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// The fill and copy kernels write one unaligned vector at the start and then
+// continue from the next aligned address, so no store splits a cache line.
+// Fills keep the pattern in phase by loading it from a doubled copy.
+inline void sse2_fill(void* dst, size_t bytes, const void* pattern) {
+    if (bytes < 32) {
+        scalar_fill(dst, bytes, pattern);
+        return;
+    }
+    char* d = static_cast<char*>(dst);
+    char doubled[64];
+    std::memcpy(doubled, pattern, 32);
+    std::memcpy(doubled + 32, pattern, 32);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(doubled)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 16), _mm_loadu_si128(reinterpret_cast<const __m128i*>(doubled + 16)));
+    size_t i = 16 - (reinterpret_cast<uintptr_t>(d) & 15);
+    const char* phase = doubled + (i & 31);
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(phase));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(phase + 16));
+    for (; i + 64 <= bytes; i += 64) {
+        _mm_store_si128(reinterpret_cast<__m128i*>(d + i), lo);
+        _mm_store_si128(reinterpret_cast<__m128i*>(d + i + 16), hi);
+        _mm_store_si128(reinterpret_cast<__m128i*>(d + i + 32), lo);
+        _mm_store_si128(reinterpret_cast<__m128i*>(d + i + 48), hi);
+    }
+    for (; i + 32 <= bytes; i += 32) {
+        _mm_store_si128(reinterpret_cast<__m128i*>(d + i), lo);
+        _mm_store_si128(reinterpret_cast<__m128i*>(d + i + 16), hi);
+    }
+    std::memcpy(d + i, phase, bytes - i);
+}
+
+inline void sse2_copy(void* dst, const void* src, size_t bytes) {
+    if (bytes < 16) {
+        std::memcpy(dst, src, bytes);
+        return;
+    }
+    char* d = static_cast<char*>(dst);
+    const char* s = static_cast<const char*>(src);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+    size_t i = 16 - (reinterpret_cast<uintptr_t>(d) & 15);
+    for (; i + 64 <= bytes; i += 64) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 32));
+        __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 48));
+        _mm_store_si128(reinterpret_cast<__m128i*>(d + i), a);
+        _mm_store_si128(reinterpret_cast<__m128i*>(d + i + 16), b);
+        _mm_store_si128(reinterpret_cast<__m128i*>(d + i + 32), c);
+        _mm_store_si128(reinterpret_cast<__m128i*>(d + i + 48), e);
+    }
+    std::memcpy(d + i, s + i, bytes - i);
+}
+
+inline size_t sse2_mismatch(const void* a, const void* b, size_t bytes) {
+    const char* x = static_cast<const char*>(a);
+    const char* y = static_cast<const char*>(b);
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i)));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(eq)) ^ 0xFFFFu;
+        if (mask != 0) {
+            return i + lowest_bit(mask);
+        }
+    }
+    return i + scalar_mismatch(x + i, y + i, bytes - i);
+}
+
+MY_SIMD_AVX2 inline void avx2_fill(void* dst, size_t bytes, const void* pattern) {
+    if (bytes < 32) {
+        scalar_fill(dst, bytes, pattern);
+        return;
+    }
+    char* d = static_cast<char*>(dst);
+    char doubled[64];
+    std::memcpy(doubled, pattern, 32);
+    std::memcpy(doubled + 32, pattern, 32);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(doubled)));
+    size_t i = 32 - (reinterpret_cast<uintptr_t>(d) & 31);
+    const char* phase = doubled + (i & 31);
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(phase));
+    for (; i + 128 <= bytes; i += 128) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d + i), v);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d + i + 32), v);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d + i + 64), v);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d + i + 96), v);
+    }
+    for (; i + 32 <= bytes; i += 32) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d + i), v);
+    }
+    std::memcpy(d + i, phase, bytes - i);
+}
+
+// Below the streaming threshold the SSE2 loop is as fast: 32-byte loads from
+// a source that is only 16-byte aligned would split cache lines.
+MY_SIMD_AVX2 inline void avx2_copy(void* dst, const void* src, size_t bytes) {
+    if (bytes < streaming_threshold) {
+        sse2_copy(dst, src, bytes);
+        return;
+    }
+    char* d = static_cast<char*>(dst);
+    const char* s = static_cast<const char*>(src);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s)));
+    size_t i = 32 - (reinterpret_cast<uintptr_t>(d) & 31);
+    for (; i + 128 <= bytes; i += 128) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 32));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 64));
+        __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + 96));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d + i), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d + i + 32), b);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d + i + 64), c);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(d + i + 96), e);
+    }
+    _mm_sfence();
+    std::memcpy(d + i, s + i, bytes - i);
+}
+
+// Both ranges usually share their alignment, so after the first vector the
+// loads start on a 32-byte boundary in both.
+MY_SIMD_AVX2 inline size_t avx2_mismatch(const void* a, const void* b, size_t bytes) {
+    if (bytes < 32) {
+        return sse2_mismatch(a, b, bytes);
+    }
+    const char* x = static_cast<const char*>(a);
+    const char* y = static_cast<const char*>(b);
+    unsigned head = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y)))));
+    if (head != 0) {
+        return lowest_bit(head);
+    }
+    size_t i = 32 - (reinterpret_cast<uintptr_t>(x) & 31);
+    for (; i + 128 <= bytes; i += 128) {
+        __m256i eq0 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i)));
+        __m256i eq1 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i + 32)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i + 32)));
+        __m256i eq2 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i + 64)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i + 64)));
+        __m256i eq3 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i + 96)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i + 96)));
+        if (_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(eq0, eq1), _mm256_and_si256(eq2, eq3))) != -1) {
+            break;
+        }
+    }
+    for (; i + 32 <= bytes; i += 32) {
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i)))));
+        if (mask != 0) {
+            return i + lowest_bit(mask);
+        }
+    }
+    return i + scalar_mismatch(x + i, y + i, bytes - i);
+}
+
+inline bool cpu_has_avx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const int osxsave_and_avx = (1 << 27) | (1 << 28);
+    if ((info[2] & osxsave_and_avx) != osxsave_and_avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+inline const kernels& selected() {
+#ifdef MY_SIMD_X86
+    static const kernels chosen = cpu_has_avx2()
+        ? kernels{ avx2_fill, avx2_copy, avx2_mismatch }
+        : kernels{ sse2_fill, sse2_copy, sse2_mismatch };
+#else
+    static const kernels chosen = { scalar_fill, scalar_copy, scalar_mismatch };
+#endif
+    return chosen;
+}
+
+static const size_t dispatch_threshold = 64;
+
+// Element types that a 32-byte pattern can repeat exactly.
+template <class T>
+struct is_fillable : std::integral_constant<bool, std::is_trivially_copyable<T>::value && 32 % sizeof(T) == 0> {};
+
+// Element types whose values are equal exactly when their bytes are. Floating
+// point types are not (NaN, signed zero), nor are structs with padding.
+template <class T>
+struct is_bytewise_comparable : std::integral_constant<bool,
+    std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value> {};
+
+template <class T>
+void uninitialized_fill(T* first, size_t n, const T& value, std::true_type) {
+    if (n * sizeof(T) < dispatch_threshold) {
+        std::uninitialized_fill(first, first + n, value);
+        return;
+    }
+    char pattern[32];
+    for (size_t i = 0; i < 32; i += sizeof(T)) {
+        std::memcpy(pattern + i, &value, sizeof(T));
+    }
+    selected().fill(first, n * sizeof(T), pattern);
+}
+
+template <class T>
+void uninitialized_fill(T* first, size_t n, const T& value, std::false_type) {
+    std::uninitialized_fill(first, first + n, value);
+}
+
+// Constructs n copies of value at first.
+template <class T>
+void uninitialized_fill(T* first, size_t n, const T& value) {
+    simd::uninitialized_fill(first, n, value, is_fillable<T>());
+}
+
+template <class T>
+void uninitialized_copy(const T* first, const T* last, T* dest, std::true_type) {
+    size_t bytes = (last - first) * sizeof(T);
+    if (bytes < dispatch_threshold) {
+        std::uninitialized_copy(first, last, dest);
+        return;
+    }
+    selected().copy(dest, first, bytes);
+}
+
+template <class InputIterator, class T>
+void uninitialized_copy(InputIterator first, InputIterator last, T* dest, std::false_type) {
+    std::uninitialized_copy(first, last, dest);
+}
+
+// Copy-constructs [first, last) into uninitialized memory at dest; the
+// ranges must not overlap. Only pointer ranges of trivially copyable
+// elements use the kernels.
+template <class InputIterator, class T>
+void uninitialized_copy(InputIterator first, InputIterator last, T* dest) {
+    typedef typename std::decay<InputIterator>::type iterator;
+    simd::uninitialized_copy(first, last, dest, std::integral_constant<bool, std::is_trivially_copyable<T>::value &&
+        (std::is_same<iterator, T*>::value || std::is_same<iterator, const T*>::value)>());
+}
+
+template <class T>
+bool equal(const T* a, const T* b, size_t n, std::true_type) {
+    size_t bytes = n * sizeof(T);
+    return bytes < dispatch_threshold ? std::equal(a, a + n, b) : selected().mismatch(a, b, bytes) == bytes;
+}
+
+template <class T>
+bool equal(const T* a, const T* b, size_t n, std::false_type) {
+    return std::equal(a, a + n, b);
+}
+
+template <class T>
+bool equal(const T* a, const T* b, size_t n) {
+    return simd::equal(a, b, n, is_bytewise_comparable<T>());
+}
+
+// The first differing byte lies in the first differing element, which then
+// decides the order.
+template <class T>
+bool lexicographical_compare(const T* a, size_t na, const T* b, size_t nb, std::true_type) {
+    size_t n = std::min(na, nb);
+    if (n * sizeof(T) < dispatch_threshold) {
+        return std::lexicographical_compare(a, a + na, b, b + nb);
+    }
+    size_t i = selected().mismatch(a, b, n * sizeof(T)) / sizeof(T);
+    return i < n ? a[i] < b[i] : na < nb;
+}
+
+template <class T>
+bool lexicographical_compare(const T* a, size_t na, const T* b, size_t nb, std::false_type) {
+    return std::lexicographical_compare(a, a + na, b, b + nb);
+}
+
+template <class T>
+bool lexicographical_compare(const T* a, size_t na, const T* b, size_t nb) {
+    return simd::lexicographical_compare(a, na, b, nb, is_bytewise_comparable<T>());
+}
+
+// Search kernels work on whole elements rather than bytes, so that floating
+// point elements compare like operator== does. They all handle the full
+// range, including the tail that does not fill a vector.
+
+template <class T>
+struct search_kernels {
+    size_t (*find)(const T* p, size_t n, T value);
+    size_t (*count)(const T* p, size_t n, T value);
+    size_t (*find_any)(const T* p, size_t n, const T* values, size_t k);
+};
+
+// find_any looks for any of at most this many values at once.
+static const size_t max_any_values = 8;
+
+template <class T>
+size_t scalar_find(const T* p, size_t n, T value) {
+    size_t i = 0;
+    while (i < n && !(p[i] == value)) {
+        ++i;
+    }
+    return i;
+}
+
+template <class T>
+size_t scalar_count(const T* p, size_t n, T value) {
+    size_t found = 0;
+    for (size_t i = 0; i < n; ++i) {
+        found += p[i] == value;
+    }
+    return found;
+}
+
+template <class T>
+size_t scalar_find_any(const T* p, size_t n, const T* values, size_t k) {
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < k; ++j) {
+            if (p[i] == values[j]) {
+                return i;
+            }
+        }
+    }
+    return n;
+}
+
+#ifdef MY_SIMD_X86
+
+// Per element type: broadcast a value and compare a vector of elements,
+// giving all-ones lanes where they are equal.
+template <class T, size_t Size = sizeof(T), bool Float = std::is_floating_point<T>::value> struct sse2_lanes;
+
+template <class T> struct sse2_lanes<T, 1, false> {
+    static __m128i splat(T v) { return _mm_set1_epi8(static_cast<char>(v)); }
+    static __m128i equal(__m128i a, __m128i b) { return _mm_cmpeq_epi8(a, b); }
+};
+
+template <class T> struct sse2_lanes<T, 2, false> {
+    static __m128i splat(T v) { return _mm_set1_epi16(static_cast<short>(v)); }
+    static __m128i equal(__m128i a, __m128i b) { return _mm_cmpeq_epi16(a, b); }
+};
+
+template <class T> struct sse2_lanes<T, 4, false> {
+    static __m128i splat(T v) { return _mm_set1_epi32(static_cast<int>(v)); }
+    static __m128i equal(__m128i a, __m128i b) { return _mm_cmpeq_epi32(a, b); }
+};
+
+// SSE2 has no 64-bit compare: both 32-bit halves have to match.
+template <class T> struct sse2_lanes<T, 8, false> {
+    static __m128i splat(T v) { return _mm_set1_epi64x(static_cast<long long>(v)); }
+    static __m128i equal(__m128i a, __m128i b) {
+        __m128i halves = _mm_cmpeq_epi32(a, b);
+        return _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+};
+
+template <class T> struct sse2_lanes<T, 4, true> {
+    static __m128i splat(T v) { return _mm_castps_si128(_mm_set1_ps(v)); }
+    static __m128i equal(__m128i a, __m128i b) { return _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b))); }
+};
+
+template <class T> struct sse2_lanes<T, 8, true> {
+    static __m128i splat(T v) { return _mm_castpd_si128(_mm_set1_pd(v)); }
+    static __m128i equal(__m128i a, __m128i b) { return _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b))); }
+};
+
+template <class T, size_t Size = sizeof(T), bool Float = std::is_floating_point<T>::value> struct avx2_lanes;
+
+template <class T> struct avx2_lanes<T, 1, false> {
+    MY_SIMD_AVX2 static __m256i splat(T v) { return _mm256_set1_epi8(static_cast<char>(v)); }
+    MY_SIMD_AVX2 static __m256i equal(__m256i a, __m256i b) { return _mm256_cmpeq_epi8(a, b); }
+};
+
+template <class T> struct avx2_lanes<T, 2, false> {
+    MY_SIMD_AVX2 static __m256i splat(T v) { return _mm256_set1_epi16(static_cast<short>(v)); }
+    MY_SIMD_AVX2 static __m256i equal(__m256i a, __m256i b) { return _mm256_cmpeq_epi16(a, b); }
+};
+
+template <class T> struct avx2_lanes<T, 4, false> {
+    MY_SIMD_AVX2 static __m256i splat(T v) { return _mm256_set1_epi32(static_cast<int>(v)); }
+    MY_SIMD_AVX2 static __m256i equal(__m256i a, __m256i b) { return _mm256_cmpeq_epi32(a, b); }
+};
+
+template <class T> struct avx2_lanes<T, 8, false> {
+    MY_SIMD_AVX2 static __m256i splat(T v) { return _mm256_set1_epi64x(static_cast<long long>(v)); }
+    MY_SIMD_AVX2 static __m256i equal(__m256i a, __m256i b) { return _mm256_cmpeq_epi64(a, b); }
+};
+
+template <class T> struct avx2_lanes<T, 4, true> {
+    MY_SIMD_AVX2 static __m256i splat(T v) { return _mm256_castps_si256(_mm256_set1_ps(v)); }
+    MY_SIMD_AVX2 static __m256i equal(__m256i a, __m256i b) {
+        return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _CMP_EQ_OQ));
+    }
+};
+
+template <class T> struct avx2_lanes<T, 8, true> {
+    MY_SIMD_AVX2 static __m256i splat(T v) { return _mm256_castpd_si256(_mm256_set1_pd(v)); }
+    MY_SIMD_AVX2 static __m256i equal(__m256i a, __m256i b) {
+        return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _CMP_EQ_OQ));
+    }
+};
+
+// find checks four vectors per step and only looks for the exact position
+// once one of them matched. count subtracts the all-ones lanes from per-byte
+// counters, which are summed before they can overflow; every match adds
+// sizeof(T) to the byte total.
+template <class T>
+size_t sse2_find(const T* p, size_t n, T value) {
+    typedef sse2_lanes<T> lanes;
+    const size_t step = 16 / sizeof(T);
+    __m128i v = lanes::splat(value);
+    size_t i = 0;
+    for (; i + 4 * step <= n; i += 4 * step) {
+        __m128i a = lanes::equal(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), v);
+        __m128i b = lanes::equal(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + step)), v);
+        __m128i c = lanes::equal(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 2 * step)), v);
+        __m128i d = lanes::equal(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 3 * step)), v);
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0) {
+            break;
+        }
+    }
+    for (; i + step <= n; i += step) {
+        unsigned mask = _mm_movemask_epi8(lanes::equal(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), v));
+        if (mask != 0) {
+            return i + lowest_bit(mask) / sizeof(T);
+        }
+    }
+    return i + scalar_find(p + i, n - i, value);
+}
+
+template <class T>
+size_t sse2_count(const T* p, size_t n, T value) {
+    typedef sse2_lanes<T> lanes;
+    const size_t step = 16 / sizeof(T);
+    __m128i v = lanes::splat(value);
+    size_t bytes = 0;
+    size_t i = 0;
+    while (i + step <= n) {
+        __m128i counters = _mm_setzero_si128();
+        for (size_t round = 0; round < 255 && i + step <= n; ++round, i += step) {
+            counters = _mm_sub_epi8(counters, lanes::equal(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), v));
+        }
+        __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+        bytes += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+    return bytes / sizeof(T) + scalar_count(p + i, n - i, value);
+}
+
+template <class T>
+size_t sse2_find_any(const T* p, size_t n, const T* values, size_t k) {
+    typedef sse2_lanes<T> lanes;
+    const size_t step = 16 / sizeof(T);
+    __m128i v[max_any_values];
+    for (size_t j = 0; j < k; ++j) {
+        v[j] = lanes::splat(values[j]);
+    }
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hit = lanes::equal(x, v[0]);
+        for (size_t j = 1; j < k; ++j) {
+            hit = _mm_or_si128(hit, lanes::equal(x, v[j]));
+        }
+        unsigned mask = _mm_movemask_epi8(hit);
+        if (mask != 0) {
+            return i + lowest_bit(mask) / sizeof(T);
+        }
+    }
+    return i + scalar_find_any(p + i, n - i, values, k);
+}
+
+template <class T>
+MY_SIMD_AVX2 size_t avx2_find(const T* p, size_t n, T value) {
+    typedef avx2_lanes<T> lanes;
+    const size_t step = 32 / sizeof(T);
+    __m256i v = lanes::splat(value);
+    size_t i = 0;
+    for (; i + 4 * step <= n; i += 4 * step) {
+        __m256i a = lanes::equal(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), v);
+        __m256i b = lanes::equal(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + step)), v);
+        __m256i c = lanes::equal(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 2 * step)), v);
+        __m256i d = lanes::equal(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 3 * step)), v);
+        if (_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d))) != 0) {
+            break;
+        }
+    }
+    for (; i + step <= n; i += step) {
+        unsigned mask = _mm256_movemask_epi8(lanes::equal(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), v));
+        if (mask != 0) {
+            return i + lowest_bit(mask) / sizeof(T);
+        }
+    }
+    return i + scalar_find(p + i, n - i, value);
+}
+
+template <class T>
+MY_SIMD_AVX2 size_t avx2_count(const T* p, size_t n, T value) {
+    typedef avx2_lanes<T> lanes;
+    const size_t step = 32 / sizeof(T);
+    __m256i v = lanes::splat(value);
+    size_t bytes = 0;
+    size_t i = 0;
+    while (i + step <= n) {
+        __m256i counters = _mm256_setzero_si256();
+        for (size_t round = 0; round < 255 && i + step <= n; ++round, i += step) {
+            counters = _mm256_sub_epi8(counters, lanes::equal(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), v));
+        }
+        __m256i wide = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+        __m128i sums = _mm_add_epi64(_mm256_castsi256_si128(wide), _mm256_extracti128_si256(wide, 1));
+        bytes += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+    return bytes / sizeof(T) + scalar_count(p + i, n - i, value);
+}
+
+template <class T>
+MY_SIMD_AVX2 size_t avx2_find_any(const T* p, size_t n, const T* values, size_t k) {
+    typedef avx2_lanes<T> lanes;
+    const size_t step = 32 / sizeof(T);
+    __m256i v[max_any_values];
+    for (size_t j = 0; j < k; ++j) {
+        v[j] = lanes::splat(values[j]);
+    }
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hit = lanes::equal(x, v[0]);
+        for (size_t j = 1; j < k; ++j) {
+            hit = _mm256_or_si256(hit, lanes::equal(x, v[j]));
+        }
+        unsigned mask = _mm256_movemask_epi8(hit);
+        if (mask != 0) {
+            return i + lowest_bit(mask) / sizeof(T);
+        }
+    }
+    return i + scalar_find_any(p + i, n - i, values, k);
+}
+
+#endif
+
+template <class T>
+const search_kernels<T>& search_selected() {
+#ifdef MY_SIMD_X86
+    static const search_kernels<T> chosen = cpu_has_avx2()
+        ? search_kernels<T>{ avx2_find<T>, avx2_count<T>, avx2_find_any<T> }
+        : search_kernels<T>{ sse2_find<T>, sse2_count<T>, sse2_find_any<T> };
+#else
+    static const search_kernels<T> chosen = { scalar_find<T>, scalar_count<T>, scalar_find_any<T> };
+#endif
+    return chosen;
+}
+
+// Integral elements of 1, 2, 4 or 8 bytes, float and double.
+template <class T>
+struct is_searchable : std::integral_constant<bool,
+    (std::is_integral<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)) ||
+    std::is_same<T, float>::value || std::is_same<T, double>::value> {};
+
+template <class T>
+const T* find(const T* first, const T* last, const T& value, std::true_type) {
+    size_t n = last - first;
+    return n * sizeof(T) < dispatch_threshold ? std::find(first, last, value) : first + search_selected<T>().find(first, n, value);
+}
+
+template <class T>
+const T* find(const T* first, const T* last, const T& value, std::false_type) {
+    return std::find(first, last, value);
+}
+
+template <class T>
+const T* find(const T* first, const T* last, const T& value) {
+    return simd::find(first, last, value, is_searchable<T>());
+}
+
+template <class T>
+size_t count(const T* first, const T* last, const T& value, std::true_type) {
+    size_t n = last - first;
+    return n * sizeof(T) < dispatch_threshold ? std::count(first, last, value) : search_selected<T>().count(first, n, value);
+}
+
+template <class T>
+size_t count(const T* first, const T* last, const T& value, std::false_type) {
+    return std::count(first, last, value);
+}
+
+template <class T>
+size_t count(const T* first, const T* last, const T& value) {
+    return simd::count(first, last, value, is_searchable<T>());
+}
+
+template <class T>
+const T* find_first_of(const T* first, const T* last, const T* values, size_t k, std::true_type) {
+    size_t n = last - first;
+    if (k == 0 || k > max_any_values || n * sizeof(T) < dispatch_threshold) {
+        return std::find_first_of(first, last, values, values + k);
+    }
+    return first + search_selected<T>().find_any(first, n, values, k);
+}
+
+template <class T>
+const T* find_first_of(const T* first, const T* last, const T* values, size_t k, std::false_type) {
+    return std::find_first_of(first, last, values, values + k);
+}
+
+// The first element equal to any of values[0, k).
+template <class T>
+const T* find_first_of(const T* first, const T* last, const T* values, size_t k) {
+    return simd::find_first_of(first, last, values, k, is_searchable<T>());
+}
+
+}
+}
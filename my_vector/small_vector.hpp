@@ -0,0 +1,551 @@
+#pragma once
+#include "my_vector.hpp"
+
+namespace my {
+
+// A vector that keeps up to N elements in storage inside the object and only
+// goes to the allocator once it outgrows them. Shrinking back to N or fewer
+// elements (shrink_to_fit, clear) returns to the inline storage.
+template <class T, size_t N, class Allocator = std::allocator<T>, class GrowthPolicy = power_of_two_growth> class small_vector {
+    typedef std::allocator_traits<Allocator> alloc_traits;
+public:
+    static_assert(N > 0, "Inline capacity must be positive");
+
+    typedef T value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    typedef T* pointer;
+    typedef Allocator allocator_type;
+    typedef GrowthPolicy growth_policy;
+
+    static const size_type inline_capacity = N;
+
+    class iterator : public std::iterator<
+        std::random_access_iterator_tag, T, ptrdiff_t, T*, T&>
+    {
+    public:
+        iterator() : pos_(nullptr) {};
+        iterator(const iterator& other) : pos_(other.pos_) {};
+        explicit iterator(pointer pos) : pos_(pos) {}
+
+        iterator& operator= (const iterator& other) { pos_ = other.pos_; return *this; };
+        bool operator== (const iterator& other) { return pos_ == other.pos_; };
+        bool operator!= (const iterator& other) { return pos_ != other.pos_; };
+        bool operator> (const iterator& other) { return pos_ > other.pos_; };
+        bool operator< (const iterator& other) { return pos_ < other.pos_; };
+        bool operator>= (const iterator& other) { return pos_ >= other.pos_; };
+        bool operator<= (const iterator& other) { return pos_ <= other.pos_; };
+
+        iterator& operator++() { ++pos_; return *this; };
+        iterator operator++(int) { iterator it(*this); ++pos_; return it; };
+        iterator& operator--() { --pos_; return *this; };
+        iterator operator--(int) { iterator it(*this); --pos_; return it; };
+        iterator& operator+=(size_type n) { pos_ += n; return *this; };
+        iterator operator+(size_type n) const { return iterator(pos_ + n); };
+        friend iterator operator+(size_type n, const iterator& that) { return iterator(that.pos_ + n); };
+        iterator& operator-=(size_type n) { pos_ -= n; return *this; };
+        iterator operator-(size_type n) const { return iterator(pos_ - n); };
+        difference_type operator-(iterator other) const { return pos_ - other.pos_; }
+
+        reference operator*() const { return *pos_; };
+        pointer operator->() const { return pos_; };
+        reference operator[](size_type n) const { return *(pos_ + n); };
+
+        pointer pos_;
+    };
+
+    small_vector() : elements_(inline_data()), size_(0), capacity_(N), allocator_() {};
+    explicit small_vector(const Allocator& alloc) : elements_(inline_data()), size_(0), capacity_(N), allocator_(alloc) {};
+    explicit small_vector(size_type n);
+    small_vector(size_type n, const T& value);
+    template <class ForwardIterator, class = typename std::enable_if<!std::is_integral<ForwardIterator>::value>::type>
+        small_vector(ForwardIterator first, ForwardIterator last);
+    small_vector(const small_vector& x);
+    small_vector(small_vector&&) noexcept(std::is_nothrow_move_constructible<T>::value);
+    small_vector(std::initializer_list<T>);
+    ~small_vector();
+
+    small_vector& operator=(const small_vector& x);
+    small_vector& operator=(small_vector&& x) noexcept(std::is_nothrow_move_constructible<T>::value);
+    small_vector& operator=(std::initializer_list<T>);
+
+    template <class ForwardIterator, class = typename std::enable_if<!std::is_integral<ForwardIterator>::value>::type>
+        void assign(ForwardIterator first, ForwardIterator last);
+    void assign(size_type n, const T& u);
+    void assign(std::initializer_list<T>);
+
+    allocator_type get_allocator() const { return allocator_; }
+
+    iterator begin() noexcept { return iterator(elements_); }
+    iterator end() noexcept { return iterator(elements_ + size_); }
+
+    size_type size() const noexcept { return size_; }
+    size_type max_size() const noexcept { return alloc_traits::max_size(allocator_); }
+    void resize(size_type sz);
+    void resize(size_type sz, const T& c);
+    size_type capacity() const noexcept { return capacity_; }
+    bool empty() const noexcept { return size_ == 0; }
+    bool is_inline() const noexcept { return elements_ == inline_data(); }
+    void reserve(size_type n) { if (n > capacity_) allocate(n); }
+    void shrink_to_fit() { allocate(size_); }
+
+    reference operator[](size_type n) { return elements_[n]; }
+    const_reference operator[](size_type n) const { return elements_[n]; }
+    const_reference at(size_type n) const;
+    reference at(size_type n);
+    reference front() { return elements_[0]; }
+    const_reference front() const { return elements_[0]; }
+    reference back() { return elements_[size_ - 1]; }
+    const_reference back() const { return elements_[size_ - 1]; }
+    pointer data() noexcept { return elements_; }
+    const T* data() const noexcept { return elements_; }
+
+    void push_back(const T& x);
+    void push_back(T&& x);
+    void pop_back();
+    iterator insert(iterator position, const T& x);
+    iterator insert(iterator position, T&& x);
+    iterator insert(iterator position, size_type n, const T& x);
+    template <class ForwardIterator, class = typename std::enable_if<!std::is_integral<ForwardIterator>::value>::type>
+        iterator insert(iterator position, ForwardIterator first, ForwardIterator last);
+    iterator insert(iterator position, std::initializer_list<T> il);
+    iterator erase(iterator position);
+    iterator erase(iterator first, iterator last);
+
+    template<class... Args> iterator emplace(iterator pos, Args&&... args);
+    template<class... Args> void emplace_back(Args&&... args);
+
+    void swap(small_vector&) noexcept(std::is_nothrow_move_constructible<T>::value);
+    void clear() noexcept;
+private:
+    pointer elements_;
+    size_type size_;
+    size_type capacity_;
+    allocator_type allocator_;
+    typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type buffer_;
+
+    pointer inline_data() noexcept { return reinterpret_cast<pointer>(&buffer_); }
+    const T* inline_data() const noexcept { return reinterpret_cast<const T*>(&buffer_); }
+
+    void allocate(size_type n);
+    void destroy_all() noexcept;
+    void take(small_vector& x) noexcept(std::is_nothrow_move_constructible<T>::value);
+    void swap_allocator(small_vector& other, std::true_type) noexcept { using std::swap; swap(allocator_, other.allocator_); }
+    void swap_allocator(small_vector& /*other*/, std::false_type) noexcept {}
+    void assign_allocator(const small_vector& other, std::true_type) noexcept { allocator_ = other.allocator_; }
+    void assign_allocator(const small_vector& /*other*/, std::false_type) noexcept {}
+    difference_type open(iterator position, size_type n);
+    void close(difference_type p, size_type n);
+    bool expand(size_type new_capacity, std::true_type);
+    bool expand(size_type /*new_capacity*/, std::false_type) { return false; }
+    void relocate(pointer first, pointer last, pointer dest, std::true_type);
+    void relocate(pointer first, pointer last, pointer dest, std::false_type);
+    void shift(pointer first, pointer last, pointer dest, std::true_type);
+    void shift(pointer first, pointer last, pointer dest, std::false_type);
+};
+
+// Capacities the growth policy puts at or below N are served from the inline
+// storage, moving back into it from the heap if necessary.
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::allocate(size_type n) {
+    size_type new_capacity = GrowthPolicy::template next_capacity<T>(capacity_, n);
+    if (new_capacity <= N) {
+        if (!is_inline()) {
+            relocate(elements_, elements_ + size_, inline_data(), is_trivially_relocatable<T>());
+            alloc_traits::deallocate(allocator_, elements_, capacity_);
+            elements_ = inline_data();
+            capacity_ = N;
+        }
+        return;
+    }
+    if (new_capacity == capacity_) {
+        return;
+    }
+    if (new_capacity > capacity_ && !is_inline() && expand(new_capacity, has_expand_in_place<Allocator>())) {
+        capacity_ = new_capacity;
+        return;
+    }
+    T* new_elements = alloc_traits::allocate(allocator_, new_capacity);
+    try {
+        relocate(elements_, elements_ + size_, new_elements, is_trivially_relocatable<T>());
+    }
+    catch (...) {
+        alloc_traits::deallocate(allocator_, new_elements, new_capacity);
+        throw;
+    }
+    if (!is_inline()) {
+        alloc_traits::deallocate(allocator_, elements_, capacity_);
+    }
+    capacity_ = new_capacity;
+    elements_ = new_elements;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+bool small_vector<T, N, Allocator, GrowthPolicy>::expand(size_type new_capacity, std::true_type) {
+    return allocator_.expand_in_place(elements_, capacity_, new_capacity);
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::relocate(pointer first, pointer last, pointer dest, std::true_type) {
+    if (first != last) {
+        std::memcpy(static_cast<void*>(dest), static_cast<const void*>(first), (last - first) * sizeof(T));
+    }
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::relocate(pointer first, pointer last, pointer dest, std::false_type) {
+    pointer current = dest;
+    try {
+        for (auto i = first; i != last; ++i, ++current) {
+            alloc_traits::construct(allocator_, current, std::move_if_noexcept(*i));
+        }
+    }
+    catch (...) {
+        for (; dest != current; ++dest) {
+            alloc_traits::destroy(allocator_, dest);
+        }
+        throw;
+    }
+    for (; first != last; ++first) {
+        alloc_traits::destroy(allocator_, first);
+    }
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::shift(pointer first, pointer last, pointer dest, std::true_type) {
+    if (first != last) {
+        std::memmove(static_cast<void*>(dest), static_cast<const void*>(first), (last - first) * sizeof(T));
+    }
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::shift(pointer first, pointer last, pointer dest, std::false_type) {
+    if (dest > first) {
+        std::move_backward(first, last, dest + (last - first));
+    }
+    else {
+        std::move(first, last, dest);
+    }
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::destroy_all() noexcept {
+    for (auto i = elements_; i < elements_ + size_; ++i) {
+        alloc_traits::destroy(allocator_, i);
+    }
+    size_ = 0;
+}
+
+// Takes over the contents of x, leaving it empty and inline. *this must be
+// empty and inline. Heap buffers change owner; inline elements are moved.
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::take(small_vector& x) noexcept(std::is_nothrow_move_constructible<T>::value) {
+    if (x.is_inline()) {
+        relocate(x.elements_, x.elements_ + x.size_, elements_, is_trivially_relocatable<T>());
+    }
+    else {
+        elements_ = x.elements_;
+        capacity_ = x.capacity_;
+        x.elements_ = x.inline_data();
+        x.capacity_ = N;
+    }
+    size_ = x.size_;
+    x.size_ = 0;
+}
+
+// Makes room for n elements at position and returns its index; close()
+// undoes it if filling the gap throws.
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+typename small_vector<T, N, Allocator, GrowthPolicy>::difference_type small_vector<T, N, Allocator, GrowthPolicy>::open(iterator position, size_type n) {
+    difference_type p = position - begin();
+    if (size_ + n > capacity_) {
+        allocate(size_ + n);
+    }
+    shift(elements_ + p, elements_ + size_, elements_ + p + n, is_trivially_relocatable<T>());
+    return p;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::close(difference_type p, size_type n) {
+    shift(elements_ + p + n, elements_ + size_ + n, elements_ + p, is_trivially_relocatable<T>());
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+small_vector<T, N, Allocator, GrowthPolicy>::small_vector(size_type n) : small_vector() {
+    resize(n);
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+small_vector<T, N, Allocator, GrowthPolicy>::small_vector(size_type n, const T& value) : small_vector() {
+    assign(n, value);
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+template <class ForwardIterator, class>
+small_vector<T, N, Allocator, GrowthPolicy>::small_vector(ForwardIterator first, ForwardIterator last) : small_vector() {
+    assign(first, last);
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+small_vector<T, N, Allocator, GrowthPolicy>::small_vector(const small_vector& x) : small_vector(alloc_traits::select_on_container_copy_construction(x.allocator_)) {
+    assign(x.elements_, x.elements_ + x.size_);
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+small_vector<T, N, Allocator, GrowthPolicy>::small_vector(small_vector&& x) noexcept(std::is_nothrow_move_constructible<T>::value) : small_vector(x.allocator_) {
+    take(x);
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+small_vector<T, N, Allocator, GrowthPolicy>::small_vector(std::initializer_list<T> l) : small_vector() {
+    assign(l);
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+small_vector<T, N, Allocator, GrowthPolicy>::~small_vector() {
+    destroy_all();
+    if (!is_inline()) {
+        alloc_traits::deallocate(allocator_, elements_, capacity_);
+    }
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+small_vector<T, N, Allocator, GrowthPolicy>& small_vector<T, N, Allocator, GrowthPolicy>::operator=(const small_vector& x) {
+    if (this != &x) {
+        if (alloc_traits::propagate_on_container_copy_assignment::value && allocator_ != x.allocator_) {
+            clear();
+            assign_allocator(x, typename alloc_traits::propagate_on_container_copy_assignment());
+        }
+        assign(x.elements_, x.elements_ + x.size_);
+    }
+    return *this;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+small_vector<T, N, Allocator, GrowthPolicy>& small_vector<T, N, Allocator, GrowthPolicy>::operator=(small_vector&& x) noexcept(std::is_nothrow_move_constructible<T>::value) {
+    if (this != &x) {
+        clear();
+        assign_allocator(x, typename alloc_traits::propagate_on_container_move_assignment());
+        if (x.is_inline() || allocator_ == x.allocator_) {
+            take(x);
+        }
+        else {
+            assign(std::make_move_iterator(x.elements_), std::make_move_iterator(x.elements_ + x.size_));
+            x.clear();
+        }
+    }
+    return *this;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+small_vector<T, N, Allocator, GrowthPolicy>& small_vector<T, N, Allocator, GrowthPolicy>::operator=(std::initializer_list<T> l) {
+    assign(l);
+    return *this;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+template <class ForwardIterator, class>
+void small_vector<T, N, Allocator, GrowthPolicy>::assign(ForwardIterator first, ForwardIterator last) {
+    destroy_all();
+    size_type new_size = std::distance(first, last);
+    if (new_size > capacity_) {
+        allocate(new_size);
+    }
+    std::uninitialized_copy(first, last, elements_);
+    size_ = new_size;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::assign(size_type n, const T& u) {
+    destroy_all();
+    if (n > capacity_) {
+        allocate(n);
+    }
+    std::uninitialized_fill(elements_, elements_ + n, u);
+    size_ = n;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::assign(std::initializer_list<T> l) {
+    assign(l.begin(), l.end());
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::resize(size_type sz) {
+    resize(sz, T());
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::resize(size_type sz, const T& c) {
+    if (sz <= size_) {
+        for (auto i = elements_ + sz; i < elements_ + size_; ++i) {
+            alloc_traits::destroy(allocator_, i);
+        }
+    }
+    else {
+        if (sz > capacity_) {
+            allocate(sz);
+        }
+        std::uninitialized_fill(elements_ + size_, elements_ + sz, c);
+    }
+    size_ = sz;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+typename small_vector<T, N, Allocator, GrowthPolicy>::const_reference small_vector<T, N, Allocator, GrowthPolicy>::at(size_type n) const {
+    if (n >= size_) {
+        throw std::out_of_range("Vector subscript out of range");
+    }
+    return elements_[n];
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+typename small_vector<T, N, Allocator, GrowthPolicy>::reference small_vector<T, N, Allocator, GrowthPolicy>::at(size_type n) {
+    if (n >= size_) {
+        throw std::out_of_range("Vector subscript out of range");
+    }
+    return elements_[n];
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::push_back(const T& x) {
+    emplace_back(x);
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::push_back(T&& x) {
+    emplace_back(std::move(x));
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::pop_back() {
+    alloc_traits::destroy(allocator_, elements_ + (--size_));
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+typename small_vector<T, N, Allocator, GrowthPolicy>::iterator small_vector<T, N, Allocator, GrowthPolicy>::insert(iterator position, const T& x) {
+    return emplace(position, x);
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+typename small_vector<T, N, Allocator, GrowthPolicy>::iterator small_vector<T, N, Allocator, GrowthPolicy>::insert(iterator position, T&& x) {
+    return emplace(position, std::move(x));
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+typename small_vector<T, N, Allocator, GrowthPolicy>::iterator small_vector<T, N, Allocator, GrowthPolicy>::insert(iterator position, size_type n, const T& x) {
+    difference_type p = open(position, n);
+    try {
+        std::uninitialized_fill(elements_ + p, elements_ + p + n, x);
+    }
+    catch (...) {
+        close(p, n);
+        throw;
+    }
+    size_ += n;
+    return begin() + p;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+template <class ForwardIterator, class>
+typename small_vector<T, N, Allocator, GrowthPolicy>::iterator small_vector<T, N, Allocator, GrowthPolicy>::insert(iterator position, ForwardIterator first, ForwardIterator last) {
+    size_type n = std::distance(first, last);
+    difference_type p = open(position, n);
+    try {
+        std::uninitialized_copy(first, last, elements_ + p);
+    }
+    catch (...) {
+        close(p, n);
+        throw;
+    }
+    size_ += n;
+    return begin() + p;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+typename small_vector<T, N, Allocator, GrowthPolicy>::iterator small_vector<T, N, Allocator, GrowthPolicy>::insert(iterator position, std::initializer_list<T> il) {
+    return insert(position, il.begin(), il.end());
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+typename small_vector<T, N, Allocator, GrowthPolicy>::iterator small_vector<T, N, Allocator, GrowthPolicy>::erase(iterator position) {
+    return erase(position, position + 1);
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+typename small_vector<T, N, Allocator, GrowthPolicy>::iterator small_vector<T, N, Allocator, GrowthPolicy>::erase(iterator first, iterator last) {
+    auto d = last - first;
+    pointer old_end = elements_ + size_;
+    if (is_trivially_relocatable<T>::value) {
+        for (auto i = first.pos_; i != last.pos_; ++i) {
+            alloc_traits::destroy(allocator_, i);
+        }
+        shift(last.pos_, old_end, first.pos_, std::true_type());
+    }
+    else {
+        for (auto i = std::move(last.pos_, old_end, first.pos_); i != old_end; ++i) {
+            alloc_traits::destroy(allocator_, i);
+        }
+    }
+    size_ -= d;
+    return first;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+template <class ... Args>
+typename small_vector<T, N, Allocator, GrowthPolicy>::iterator small_vector<T, N, Allocator, GrowthPolicy>::emplace(iterator pos, Args&&... args) {
+    difference_type p = open(pos, 1);
+    try {
+        alloc_traits::construct(allocator_, elements_ + p, std::forward<Args>(args)...);
+    }
+    catch (...) {
+        close(p, 1);
+        throw;
+    }
+    ++size_;
+    return begin() + p;
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+template <class ... Args>
+void small_vector<T, N, Allocator, GrowthPolicy>::emplace_back(Args&&... args) {
+    if (size_ + 1 > capacity_) {
+        allocate(size_ + 1);
+    }
+    alloc_traits::construct(allocator_, elements_ + size_, std::forward<Args>(args)...);
+    ++size_;
+}
+
+// Heap buffers are exchanged; inline contents have to be moved through a
+// temporary.
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::swap(small_vector& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+    if (this == &other) {
+        return;
+    }
+    if (!is_inline() && !other.is_inline()) {
+        std::swap(elements_, other.elements_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+    }
+    else {
+        small_vector tmp(std::move(other));
+        other.take(*this);
+        take(tmp);
+    }
+    swap_allocator(other, typename alloc_traits::propagate_on_container_swap());
+}
+
+template <class T, size_t N, class Allocator, class GrowthPolicy>
+void small_vector<T, N, Allocator, GrowthPolicy>::clear() noexcept {
+    destroy_all();
+    if (!is_inline()) {
+        alloc_traits::deallocate(allocator_, elements_, capacity_);
+        elements_ = inline_data();
+        capacity_ = N;
+    }
+}
+
+}
@@ -0,0 +1,352 @@
+#pragma once
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "allocator.hpp"
+#include "growth_policy.hpp"
+#include "relocation.hpp"
+
+namespace my {
+
+// A view of a contiguous run of elements.
+template <class T> class span {
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef size_t size_type;
+
+    span() noexcept : data_(nullptr), size_(0) {}
+    span(T* data, size_type size) noexcept : data_(data), size_(size) {}
+
+    T* data() const noexcept { return data_; }
+    size_type size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    iterator begin() const noexcept { return data_; }
+    iterator end() const noexcept { return data_ + size_; }
+    T& operator[](size_type n) const { return data_[n]; }
+private:
+    T* data_;
+    size_type size_;
+};
+
+// A vector of rows with the given fields, stored as one array per field
+// (structure of arrays), so a loop over one field only loads that field.
+// Every column is allocated through my::allocator and all columns share a
+// single capacity, grown with my::vector's default growth policy.
+//
+// Rows are accessed through proxies: operator[] returns a tuple of
+// references to the row's fields. column<I>() gives the whole I-th field as a
+// contiguous span for scans.
+//
+// Relocating a column during growth must not fail halfway through, so every
+// field type needs a non-throwing move constructor.
+template <class... Fields> class soa_vector {
+    template <class F> struct is_relocatable_field
+        : std::integral_constant<bool, std::is_nothrow_move_constructible<F>::value || is_trivially_relocatable<F>::value> {};
+    template <bool...> struct all_of_helper;
+    template <bool... B> struct all_of : std::is_same<all_of_helper<B..., true>, all_of_helper<true, B...>> {};
+
+    typedef std::index_sequence_for<Fields...> columns;
+    typedef std::tuple<Fields*...> column_pointers;
+public:
+    static_assert(sizeof...(Fields) > 0, "soa_vector needs at least one field");
+    static_assert(all_of<is_relocatable_field<Fields>::value...>::value, "soa_vector fields must be nothrow move constructible");
+
+    typedef std::tuple<Fields...> value_type;
+    typedef std::tuple<Fields&...> reference;
+    typedef std::tuple<const Fields&...> const_reference;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    typedef power_of_two_growth growth_policy;
+
+    template <size_t I> using field_type = typename std::tuple_element<I, value_type>::type;
+
+    soa_vector() noexcept : columns_(), size_(0), capacity_(0) {}
+    explicit soa_vector(size_type n);
+    soa_vector(std::initializer_list<value_type> il);
+    soa_vector(const soa_vector& x);
+    soa_vector(soa_vector&& x) noexcept;
+    ~soa_vector();
+
+    soa_vector& operator=(const soa_vector& x);
+    soa_vector& operator=(soa_vector&& x) noexcept;
+
+    size_type size() const noexcept { return size_; }
+    size_type max_size() const noexcept { return memory_pool::max_size / sizeof(value_type); }
+    size_type capacity() const noexcept { return capacity_; }
+    bool empty() const noexcept { return size_ == 0; }
+    void resize(size_type sz);
+    void resize(size_type sz, const value_type& row);
+    void reserve(size_type n) { if (n > capacity_) reallocate(n); }
+    void shrink_to_fit() { if (size_ < capacity_) reallocate(size_); }
+
+    reference operator[](size_type n) { return row<reference>(n, columns()); }
+    const_reference operator[](size_type n) const { return row<const_reference>(n, columns()); }
+    reference at(size_type n);
+    const_reference at(size_type n) const;
+    reference front() { return (*this)[0]; }
+    const_reference front() const { return (*this)[0]; }
+    reference back() { return (*this)[size_ - 1]; }
+    const_reference back() const { return (*this)[size_ - 1]; }
+
+    template <size_t I> span<field_type<I>> column() noexcept { return span<field_type<I>>(std::get<I>(columns_), size_); }
+    template <size_t I> span<const field_type<I>> column() const noexcept { return span<const field_type<I>>(std::get<I>(columns_), size_); }
+
+    void push_back(const Fields&... fields) { emplace_back(fields...); }
+    void push_back(const value_type& row);
+    // Takes one argument per field.
+    template <class... Args> void emplace_back(Args&&... args);
+    void pop_back();
+
+    void swap(soa_vector&) noexcept;
+    void clear() noexcept;
+private:
+    column_pointers columns_;
+    size_type size_;
+    size_type capacity_;
+
+    template <class Tuple, class F, size_t... I>
+    static void for_each(Tuple& t, F f, std::index_sequence<I...>) {
+        (void)std::initializer_list<int>{ (f(std::get<I>(t)), 0)... };
+    }
+    template <class F, size_t... I>
+    static void for_each_pair(column_pointers& a, column_pointers& b, F f, std::index_sequence<I...>) {
+        (void)std::initializer_list<int>{ (f(std::get<I>(a), std::get<I>(b)), 0)... };
+    }
+    template <class Reference, size_t... I>
+    Reference row(size_type n, std::index_sequence<I...>) const { return Reference(std::get<I>(columns_)[n]...); }
+
+    template <class F> static void relocate(F* from, F* to, size_type n, std::true_type);
+    template <class F> static void relocate(F* from, F* to, size_type n, std::false_type);
+    static void deallocate(column_pointers& columns, size_type n) noexcept;
+
+    void reallocate(size_type n);
+    void grow(size_type n) { if (n > capacity_) reallocate(growth_policy::template next_capacity<value_type>(capacity_, n)); }
+    template <class Tuple, size_t... I> void construct(size_type n, Tuple&& row, std::index_sequence<I...>);
+    void destroy(size_type first, size_type last) noexcept;
+};
+
+template <class... Fields>
+soa_vector<Fields...>::soa_vector(size_type n) : soa_vector() {
+    resize(n);
+}
+
+template <class... Fields>
+soa_vector<Fields...>::soa_vector(std::initializer_list<value_type> il) : soa_vector() {
+    reserve(il.size());
+    for (auto& x : il) {
+        push_back(x);
+    }
+}
+
+template <class... Fields>
+soa_vector<Fields...>::soa_vector(const soa_vector& x) : soa_vector() {
+    reserve(x.size_);
+    for (size_type i = 0; i < x.size_; ++i) {
+        construct(i, x[i], columns());
+        ++size_;
+    }
+}
+
+template <class... Fields>
+soa_vector<Fields...>::soa_vector(soa_vector&& x) noexcept : soa_vector() {
+    swap(x);
+}
+
+template <class... Fields>
+soa_vector<Fields...>::~soa_vector() {
+    destroy(0, size_);
+    deallocate(columns_, capacity_);
+}
+
+template <class... Fields>
+soa_vector<Fields...>& soa_vector<Fields...>::operator=(const soa_vector& x) {
+    if (this != &x) {
+        soa_vector tmp(x);
+        swap(tmp);
+    }
+    return *this;
+}
+
+template <class... Fields>
+soa_vector<Fields...>& soa_vector<Fields...>::operator=(soa_vector&& x) noexcept {
+    soa_vector tmp(std::move(x));
+    swap(tmp);
+    return *this;
+}
+
+template <class... Fields>
+template <class F>
+void soa_vector<Fields...>::relocate(F* from, F* to, size_type n, std::true_type) {
+    if (n > 0) {
+        std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), n * sizeof(F));
+    }
+}
+
+template <class... Fields>
+template <class F>
+void soa_vector<Fields...>::relocate(F* from, F* to, size_type n, std::false_type) {
+    for (size_type i = 0; i < n; ++i) {
+        ::new (static_cast<void*>(to + i)) F(std::move(from[i]));
+        from[i].~F();
+    }
+}
+
+template <class... Fields>
+void soa_vector<Fields...>::deallocate(column_pointers& columns, size_type n) noexcept {
+    for_each(columns, [n](auto column) {
+        typedef typename std::remove_pointer<decltype(column)>::type F;
+        allocator<F>().deallocate(column, n);
+    }, soa_vector::columns());
+}
+
+// All new columns are allocated before any element moves, so a failed
+// allocation leaves the vector as it was.
+template <class... Fields>
+void soa_vector<Fields...>::reallocate(size_type n) {
+    if (n > max_size()) {
+        throw std::length_error("Too many elements");
+    }
+    column_pointers fresh;
+    for_each(fresh, [](auto& column) { column = nullptr; }, columns());
+    try {
+        for_each(fresh, [n](auto& column) {
+            typedef typename std::remove_pointer<typename std::remove_reference<decltype(column)>::type>::type F;
+            column = allocator<F>().allocate(n);
+        }, columns());
+    }
+    catch (...) {
+        deallocate(fresh, n);
+        throw;
+    }
+    size_type count = size_;
+    for_each_pair(columns_, fresh, [count](auto from, auto to) {
+        typedef typename std::remove_pointer<decltype(from)>::type F;
+        relocate(from, to, count, is_trivially_relocatable<F>());
+    }, columns());
+    deallocate(columns_, capacity_);
+    columns_ = fresh;
+    capacity_ = n;
+}
+
+// Constructs every field of row n from the matching element of the tuple,
+// undoing the fields already built if one of them throws.
+template <class... Fields>
+template <class Tuple, size_t... I>
+void soa_vector<Fields...>::construct(size_type n, Tuple&& row, std::index_sequence<I...>) {
+    size_type built = 0;
+    try {
+        (void)std::initializer_list<int>{ (::new (static_cast<void*>(std::get<I>(columns_) + n))
+            Fields(std::get<I>(std::forward<Tuple>(row))), ++built, 0)... };
+    }
+    catch (...) {
+        size_type column = 0;
+        for_each(columns_, [n, built, &column](auto pointer) {
+            typedef typename std::remove_pointer<decltype(pointer)>::type F;
+            if (column++ < built) {
+                pointer[n].~F();
+            }
+        }, columns());
+        throw;
+    }
+}
+
+template <class... Fields>
+void soa_vector<Fields...>::destroy(size_type first, size_type last) noexcept {
+    for_each(columns_, [first, last](auto column) {
+        typedef typename std::remove_pointer<decltype(column)>::type F;
+        for (size_type i = first; i < last; ++i) {
+            column[i].~F();
+        }
+    }, columns());
+}
+
+template <class... Fields>
+void soa_vector<Fields...>::resize(size_type sz) {
+    resize(sz, value_type());
+}
+
+template <class... Fields>
+void soa_vector<Fields...>::resize(size_type sz, const value_type& row) {
+    if (sz <= size_) {
+        destroy(sz, size_);
+        size_ = sz;
+        return;
+    }
+    value_type value(row);
+    grow(sz);
+    while (size_ < sz) {
+        construct(size_, value, columns());
+        ++size_;
+    }
+}
+
+template <class... Fields>
+typename soa_vector<Fields...>::reference soa_vector<Fields...>::at(size_type n) {
+    if (n >= size_) {
+        throw std::out_of_range("Out of range");
+    }
+    return (*this)[n];
+}
+
+template <class... Fields>
+typename soa_vector<Fields...>::const_reference soa_vector<Fields...>::at(size_type n) const {
+    if (n >= size_) {
+        throw std::out_of_range("Out of range");
+    }
+    return (*this)[n];
+}
+
+template <class... Fields>
+void soa_vector<Fields...>::push_back(const value_type& row) {
+    if (size_ == capacity_) {
+        value_type value(row);
+        grow(size_ + 1);
+        construct(size_, std::move(value), columns());
+    }
+    else {
+        construct(size_, row, columns());
+    }
+    ++size_;
+}
+
+// Growing moves the columns, so when it is needed the row is built first in
+// case the arguments refer into the vector.
+template <class... Fields>
+template <class... Args>
+void soa_vector<Fields...>::emplace_back(Args&&... args) {
+    static_assert(sizeof...(Args) == sizeof...(Fields), "emplace_back takes one argument per field");
+    if (size_ == capacity_) {
+        value_type value(std::forward<Args>(args)...);
+        grow(size_ + 1);
+        construct(size_, std::move(value), columns());
+    }
+    else {
+        construct(size_, std::forward_as_tuple(std::forward<Args>(args)...), columns());
+    }
+    ++size_;
+}
+
+template <class... Fields>
+void soa_vector<Fields...>::pop_back() {
+    destroy(size_ - 1, size_);
+    --size_;
+}
+
+template <class... Fields>
+void soa_vector<Fields...>::swap(soa_vector& other) noexcept {
+    std::swap(columns_, other.columns_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+}
+
+template <class... Fields>
+void soa_vector<Fields...>::clear() noexcept {
+    destroy(0, size_);
+    size_ = 0;
+}
+
+}
@@ -0,0 +1,358 @@
+#pragma once
+#include "allocator.hpp"
+#include "my_vector.hpp"
+
+namespace my {
+
+constexpr size_t floor_power_of_two(size_t n) noexcept {
+    return n < 2 ? 1 : 2 * floor_power_of_two(n / 2);
+}
+
+constexpr size_t floor_log2(size_t n) noexcept {
+    return n < 2 ? 0 : 1 + floor_log2(n / 2);
+}
+
+// The largest power-of-two element count that fits in a 4KB block.
+template <class T>
+constexpr size_t stable_vector_block_size() noexcept {
+    return floor_power_of_two(sizeof(T) < 4096 ? 4096 / sizeof(T) : 1);
+}
+
+// A vector stored in fixed-size blocks of BlockSize elements, reached through
+// a directory of block pointers. Growing adds a block and never moves
+// existing elements, so pointers and references stay valid until their
+// element is removed; iterators are invalidated by growth, as in std::deque.
+// BlockSize is a power of two, so indexing is a shift and a mask.
+//
+// The directory ends with a null entry after the last block, which lets
+// iterators step off the last block without consulting the container.
+template <class T, size_t BlockSize = stable_vector_block_size<T>(), class Allocator = allocator<T>> class stable_vector {
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef vector<T*, typename alloc_traits::template rebind_alloc<T*>> directory_type;
+public:
+    static_assert(BlockSize > 0 && (BlockSize & (BlockSize - 1)) == 0, "Block size must be a power of two");
+
+    typedef T value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    typedef T* pointer;
+    typedef Allocator allocator_type;
+
+    static const size_type block_size = BlockSize;
+    static const size_type block_shift = floor_log2(BlockSize);
+    static const size_type block_mask = BlockSize - 1;
+
+    class iterator : public std::iterator<
+        std::random_access_iterator_tag, T, ptrdiff_t, T*, T&>
+    {
+    public:
+        iterator() : node_(nullptr), pos_(nullptr), last_(nullptr) {};
+        iterator(pointer* node, size_type offset) { set(node, static_cast<difference_type>(offset)); }
+
+        bool operator== (const iterator& other) const { return pos_ == other.pos_; };
+        bool operator!= (const iterator& other) const { return pos_ != other.pos_; };
+        bool operator< (const iterator& other) const { return node_ < other.node_ || (node_ == other.node_ && pos_ < other.pos_); };
+        bool operator> (const iterator& other) const { return other < *this; };
+        bool operator<= (const iterator& other) const { return !(other < *this); };
+        bool operator>= (const iterator& other) const { return !(*this < other); };
+
+        iterator& operator++() {
+            if (++pos_ == last_) {
+                set(node_ + 1, 0);
+            }
+            return *this;
+        };
+        iterator operator++(int) { iterator it(*this); ++*this; return it; };
+        iterator& operator--() {
+            if (pos_ == *node_) {
+                set(node_ - 1, BlockSize - 1);
+            }
+            else {
+                --pos_;
+            }
+            return *this;
+        };
+        iterator operator--(int) { iterator it(*this); --*this; return it; };
+        iterator& operator+=(difference_type n) { set(node_, pos_ - *node_ + n); return *this; };
+        iterator operator+(difference_type n) const { iterator it(*this); return it += n; };
+        friend iterator operator+(difference_type n, const iterator& that) { return that + n; };
+        iterator& operator-=(difference_type n) { return *this += -n; };
+        iterator operator-(difference_type n) const { iterator it(*this); return it += -n; };
+        difference_type operator-(const iterator& other) const {
+            return (node_ - other.node_) * static_cast<difference_type>(BlockSize) + (pos_ - *node_) - (other.pos_ - *other.node_);
+        }
+
+        reference operator*() const { return *pos_; };
+        pointer operator->() const { return pos_; };
+        reference operator[](difference_type n) const { return *(*this + n); };
+
+    private:
+        pointer* node_;
+        pointer pos_;
+        pointer last_;
+
+        // Points at element offset of the block at node; offset may run
+        // outside the block in either direction.
+        void set(pointer* node, difference_type offset) {
+            difference_type blocks = offset >= 0 ? offset >> block_shift : -((-offset - 1) >> block_shift) - 1;
+            node_ = node + blocks;
+            pos_ = *node_ != nullptr ? *node_ + (offset - blocks * static_cast<difference_type>(BlockSize)) : nullptr;
+            last_ = *node_ != nullptr ? *node_ + BlockSize : nullptr;
+        }
+    };
+
+    stable_vector() : size_(0), allocator_(), blocks_(allocator_) {};
+    explicit stable_vector(const Allocator& alloc) : size_(0), allocator_(alloc), blocks_(allocator_) {};
+    stable_vector(size_type n, const T& value, const Allocator& alloc = Allocator());
+    stable_vector(std::initializer_list<T>, const Allocator& alloc = Allocator());
+    stable_vector(const stable_vector& x);
+    stable_vector(stable_vector&& x) noexcept;
+    ~stable_vector();
+
+    stable_vector& operator=(const stable_vector& x);
+    stable_vector& operator=(stable_vector&& x) noexcept(alloc_traits::propagate_on_container_move_assignment::value || std::is_empty<Allocator>::value);
+
+    allocator_type get_allocator() const { return allocator_; }
+
+    iterator begin() noexcept { return blocks_.empty() ? iterator() : iterator(blocks_.data(), 0); }
+    iterator end() noexcept { return blocks_.empty() ? iterator() : iterator(blocks_.data() + (size_ >> block_shift), size_ & block_mask); }
+
+    size_type size() const noexcept { return size_; }
+    size_type max_size() const noexcept { return alloc_traits::max_size(allocator_); }
+    size_type capacity() const noexcept { return block_count() * BlockSize; }
+    bool empty() const noexcept { return size_ == 0; }
+    void resize(size_type sz);
+    void resize(size_type sz, const T& c);
+    void reserve(size_type n);
+    // Frees the blocks past the last element.
+    void shrink_to_fit();
+
+    reference operator[](size_type n) { return blocks_[n >> block_shift][n & block_mask]; }
+    const_reference operator[](size_type n) const { return blocks_[n >> block_shift][n & block_mask]; }
+    reference at(size_type n);
+    const_reference at(size_type n) const;
+    reference front() { return (*this)[0]; }
+    const_reference front() const { return (*this)[0]; }
+    reference back() { return (*this)[size_ - 1]; }
+    const_reference back() const { return (*this)[size_ - 1]; }
+
+    void push_back(const T& x) { emplace_back(x); }
+    void push_back(T&& x) { emplace_back(std::move(x)); }
+    template<class... Args> void emplace_back(Args&&... args);
+    void pop_back();
+
+    void swap(stable_vector&) noexcept;
+    void clear() noexcept;
+private:
+    size_type size_;
+    allocator_type allocator_;
+    directory_type blocks_;
+
+    size_type block_count() const noexcept { return blocks_.empty() ? 0 : blocks_.size() - 1; }
+    void add_block();
+    void release_blocks(size_type keep) noexcept;
+    // The directory's own swap follows the same trait and moves its allocator
+    // along with allocator_.
+    void swap_allocator(stable_vector& other, std::true_type) noexcept { using std::swap; swap(allocator_, other.allocator_); }
+    void swap_allocator(stable_vector& /*other*/, std::false_type) noexcept {}
+    void assign_allocator(const stable_vector& other, std::true_type) noexcept { allocator_ = other.allocator_; }
+    void assign_allocator(const stable_vector& /*other*/, std::false_type) noexcept {}
+};
+
+template <class T, size_t BlockSize, class Allocator>
+stable_vector<T, BlockSize, Allocator>::stable_vector(size_type n, const T& value, const Allocator& alloc) : stable_vector(alloc) {
+    resize(n, value);
+}
+
+template <class T, size_t BlockSize, class Allocator>
+stable_vector<T, BlockSize, Allocator>::stable_vector(std::initializer_list<T> il, const Allocator& alloc) : stable_vector(alloc) {
+    reserve(il.size());
+    for (auto& x : il) {
+        emplace_back(x);
+    }
+}
+
+template <class T, size_t BlockSize, class Allocator>
+stable_vector<T, BlockSize, Allocator>::stable_vector(const stable_vector& x)
+    : stable_vector(alloc_traits::select_on_container_copy_construction(x.allocator_)) {
+    reserve(x.size_);
+    for (size_type i = 0; i < x.size_; ++i) {
+        emplace_back(x[i]);
+    }
+}
+
+template <class T, size_t BlockSize, class Allocator>
+stable_vector<T, BlockSize, Allocator>::stable_vector(stable_vector&& x) noexcept : stable_vector(x.allocator_) {
+    swap(x);
+}
+
+template <class T, size_t BlockSize, class Allocator>
+stable_vector<T, BlockSize, Allocator>::~stable_vector() {
+    clear();
+    release_blocks(0);
+}
+
+// Blocks are only handed between vectors whose allocators compare equal, or
+// together with the allocator when it propagates; the directory is assigned
+// alongside, so it follows the same allocator. Otherwise the elements are
+// copied or moved one by one into blocks of this vector's allocator.
+template <class T, size_t BlockSize, class Allocator>
+stable_vector<T, BlockSize, Allocator>& stable_vector<T, BlockSize, Allocator>::operator=(const stable_vector& x) {
+    if (this != &x) {
+        clear();
+        if (alloc_traits::propagate_on_container_copy_assignment::value && allocator_ != x.allocator_) {
+            release_blocks(0);
+            assign_allocator(x, typename alloc_traits::propagate_on_container_copy_assignment());
+            blocks_ = x.blocks_;
+            blocks_.clear();
+        }
+        reserve(x.size_);
+        for (size_type i = 0; i < x.size_; ++i) {
+            emplace_back(x[i]);
+        }
+    }
+    return *this;
+}
+
+template <class T, size_t BlockSize, class Allocator>
+stable_vector<T, BlockSize, Allocator>& stable_vector<T, BlockSize, Allocator>::operator=(stable_vector&& x) noexcept(alloc_traits::propagate_on_container_move_assignment::value || std::is_empty<Allocator>::value) {
+    if (this == &x) {
+        return *this;
+    }
+    clear();
+    if (alloc_traits::propagate_on_container_move_assignment::value || allocator_ == x.allocator_) {
+        release_blocks(0);
+        assign_allocator(x, typename alloc_traits::propagate_on_container_move_assignment());
+        blocks_ = std::move(x.blocks_);
+        size_ = x.size_;
+        x.size_ = 0;
+    }
+    else {
+        reserve(x.size_);
+        for (size_type i = 0; i < x.size_; ++i) {
+            emplace_back(std::move(x[i]));
+        }
+        x.clear();
+    }
+    return *this;
+}
+
+template <class T, size_t BlockSize, class Allocator>
+void stable_vector<T, BlockSize, Allocator>::add_block() {
+    pointer block = alloc_traits::allocate(allocator_, BlockSize);
+    try {
+        if (blocks_.empty()) {
+            blocks_.push_back(nullptr);
+        }
+        blocks_.push_back(nullptr);
+    }
+    catch (...) {
+        alloc_traits::deallocate(allocator_, block, BlockSize);
+        throw;
+    }
+    blocks_[blocks_.size() - 2] = block;
+}
+
+template <class T, size_t BlockSize, class Allocator>
+void stable_vector<T, BlockSize, Allocator>::release_blocks(size_type keep) noexcept {
+    size_type count = block_count();
+    for (size_type i = keep; i < count; ++i) {
+        alloc_traits::deallocate(allocator_, blocks_[i], BlockSize);
+    }
+    if (keep == 0) {
+        blocks_.clear();
+    }
+    else if (keep < count) {
+        blocks_.resize(keep + 1);
+        blocks_[keep] = nullptr;
+    }
+}
+
+template <class T, size_t BlockSize, class Allocator>
+void stable_vector<T, BlockSize, Allocator>::reserve(size_type n) {
+    if (n > max_size()) {
+        throw std::length_error("Too many elements");
+    }
+    while (capacity() < n) {
+        add_block();
+    }
+}
+
+template <class T, size_t BlockSize, class Allocator>
+void stable_vector<T, BlockSize, Allocator>::shrink_to_fit() {
+    release_blocks((size_ + BlockSize - 1) >> block_shift);
+}
+
+template <class T, size_t BlockSize, class Allocator>
+void stable_vector<T, BlockSize, Allocator>::resize(size_type sz) {
+    reserve(sz);
+    while (size_ < sz) {
+        emplace_back();
+    }
+    while (size_ > sz) {
+        pop_back();
+    }
+}
+
+template <class T, size_t BlockSize, class Allocator>
+void stable_vector<T, BlockSize, Allocator>::resize(size_type sz, const T& c) {
+    reserve(sz);
+    while (size_ < sz) {
+        emplace_back(c);
+    }
+    while (size_ > sz) {
+        pop_back();
+    }
+}
+
+template <class T, size_t BlockSize, class Allocator>
+typename stable_vector<T, BlockSize, Allocator>::reference stable_vector<T, BlockSize, Allocator>::at(size_type n) {
+    if (n >= size_) {
+        throw std::out_of_range("Out of range");
+    }
+    return (*this)[n];
+}
+
+template <class T, size_t BlockSize, class Allocator>
+typename stable_vector<T, BlockSize, Allocator>::const_reference stable_vector<T, BlockSize, Allocator>::at(size_type n) const {
+    if (n >= size_) {
+        throw std::out_of_range("Out of range");
+    }
+    return (*this)[n];
+}
+
+// Adding a block never moves elements, so args may refer into the vector.
+template <class T, size_t BlockSize, class Allocator>
+template <class... Args>
+void stable_vector<T, BlockSize, Allocator>::emplace_back(Args&&... args) {
+    if (size_ == capacity()) {
+        add_block();
+    }
+    alloc_traits::construct(allocator_, &(*this)[size_], std::forward<Args>(args)...);
+    ++size_;
+}
+
+template <class T, size_t BlockSize, class Allocator>
+void stable_vector<T, BlockSize, Allocator>::pop_back() {
+    --size_;
+    alloc_traits::destroy(allocator_, &(*this)[size_]);
+}
+
+template <class T, size_t BlockSize, class Allocator>
+void stable_vector<T, BlockSize, Allocator>::swap(stable_vector& other) noexcept {
+    using std::swap;
+    swap(size_, other.size_);
+    blocks_.swap(other.blocks_);
+    swap_allocator(other, typename alloc_traits::propagate_on_container_swap());
+}
+
+template <class T, size_t BlockSize, class Allocator>
+void stable_vector<T, BlockSize, Allocator>::clear() noexcept {
+    while (size_ > 0) {
+        pop_back();
+    }
+}
+
+}
@@ -0,0 +1,444 @@
+#pragma once
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+#include <iterator>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <initializer_list>
+#include "relocation.hpp"
+
+namespace my {
+
+// Overflow policies decide what a static_vector does when an operation would
+// take it past its capacity. overflow() either does not return or returns
+// false, in which case the operation leaves the vector unchanged.
+
+struct throw_on_overflow {
+    static bool overflow() {
+        throw std::length_error("static_vector capacity exceeded");
+    }
+};
+
+struct terminate_on_overflow {
+    static bool overflow() noexcept {
+        std::terminate();
+    }
+};
+
+struct fail_on_overflow {
+    static constexpr bool overflow() noexcept {
+        return false;
+    }
+};
+
+// Storage for static_vector. Trivial element types live in a plain array, so
+// the whole vector is a trivially copyable literal type that can be built in
+// constant expressions; everything else goes into raw storage and is
+// constructed and destroyed element by element.
+template <class T, size_t N, bool = std::is_trivial<T>::value>
+class static_vector_storage {
+protected:
+    constexpr static_vector_storage() noexcept : elements_(), size_(0) {}
+    template <size_t... I>
+    constexpr static_vector_storage(const T* first, size_t count, std::index_sequence<I...>)
+        : elements_{ (I < count ? first[I] : T())... }, size_(count) {}
+    template <size_t... I>
+    constexpr static_vector_storage(const T& value, size_t count, std::index_sequence<I...>)
+        : elements_{ (I < count ? value : T())... }, size_(count) {}
+
+    T* storage() noexcept { return elements_; }
+    constexpr const T* storage() const noexcept { return elements_; }
+
+    T elements_[N];
+    size_t size_;
+};
+
+template <class T, size_t N>
+class static_vector_storage<T, N, false> {
+protected:
+    static_vector_storage() noexcept : size_(0) {}
+    // A constructor that throws does not run the destructor, so the elements
+    // built so far are destroyed here.
+    template <size_t... I>
+    static_vector_storage(const T* first, size_t count, std::index_sequence<I...>) : size_(0) {
+        try {
+            for (; size_ < count; ++size_) {
+                ::new (static_cast<void*>(storage() + size_)) T(first[size_]);
+            }
+        }
+        catch (...) {
+            destroy(0);
+            throw;
+        }
+    }
+    template <size_t... I>
+    static_vector_storage(const T& value, size_t count, std::index_sequence<I...>) : size_(0) {
+        try {
+            for (; size_ < count; ++size_) {
+                ::new (static_cast<void*>(storage() + size_)) T(value);
+            }
+        }
+        catch (...) {
+            destroy(0);
+            throw;
+        }
+    }
+    static_vector_storage(const static_vector_storage& x) : static_vector_storage(x.storage(), x.size_, std::index_sequence<>()) {}
+    static_vector_storage(static_vector_storage&& x) noexcept(std::is_nothrow_move_constructible<T>::value) : size_(0) {
+        try {
+            for (; size_ < x.size_; ++size_) {
+                ::new (static_cast<void*>(storage() + size_)) T(std::move(x.storage()[size_]));
+            }
+        }
+        catch (...) {
+            destroy(0);
+            throw;
+        }
+    }
+    ~static_vector_storage() {
+        destroy(0);
+    }
+
+    static_vector_storage& operator=(const static_vector_storage& x) {
+        if (this != &x) {
+            destroy(0);
+            for (; size_ < x.size_; ++size_) {
+                ::new (static_cast<void*>(storage() + size_)) T(x.storage()[size_]);
+            }
+        }
+        return *this;
+    }
+    static_vector_storage& operator=(static_vector_storage&& x) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        if (this != &x) {
+            destroy(0);
+            for (; size_ < x.size_; ++size_) {
+                ::new (static_cast<void*>(storage() + size_)) T(std::move(x.storage()[size_]));
+            }
+        }
+        return *this;
+    }
+
+    T* storage() noexcept { return reinterpret_cast<T*>(&buffer_); }
+    const T* storage() const noexcept { return reinterpret_cast<const T*>(&buffer_); }
+
+    void destroy(size_t from) noexcept {
+        while (size_ > from) {
+            storage()[--size_].~T();
+        }
+    }
+
+    typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type buffer_;
+    size_t size_;
+};
+
+// A vector with capacity N that lives entirely inside the object and never
+// allocates. Operations that would exceed N call OverflowPolicy::overflow();
+// with fail_on_overflow they leave the vector unchanged and report failure:
+// push_back, emplace_back, resize and assign return false, insert and emplace
+// return a null iterator. Constructors keep the first N elements.
+template <class T, size_t N, class OverflowPolicy = throw_on_overflow>
+class static_vector : private static_vector_storage<T, N> {
+    typedef static_vector_storage<T, N> storage_type;
+    using storage_type::storage;
+    using storage_type::size_;
+public:
+    static_assert(N > 0, "Capacity must be positive");
+
+    typedef T value_type;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef ptrdiff_t difference_type;
+    typedef size_t size_type;
+    typedef T* pointer;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    typedef OverflowPolicy overflow_policy;
+
+    constexpr static_vector() noexcept : storage_type() {}
+    constexpr static_vector(size_type n, const T& value)
+        : storage_type(value, fit(n), std::make_index_sequence<N>()) {}
+    constexpr static_vector(std::initializer_list<T> l)
+        : storage_type(l.begin(), fit(l.size()), std::make_index_sequence<N>()) {}
+    explicit static_vector(size_type n);
+    template <class ForwardIterator, class = typename std::enable_if<!std::is_integral<ForwardIterator>::value>::type>
+        static_vector(ForwardIterator first, ForwardIterator last);
+
+    static_vector& operator=(std::initializer_list<T> l) { assign(l); return *this; }
+
+    template <class ForwardIterator, class = typename std::enable_if<!std::is_integral<ForwardIterator>::value>::type>
+        bool assign(ForwardIterator first, ForwardIterator last);
+    bool assign(size_type n, const T& u);
+    bool assign(std::initializer_list<T> l) { return assign(l.begin(), l.end()); }
+
+    iterator begin() noexcept { return storage(); }
+    iterator end() noexcept { return storage() + size_; }
+    constexpr const_iterator begin() const noexcept { return storage(); }
+    constexpr const_iterator end() const noexcept { return storage() + size_; }
+
+    constexpr size_type size() const noexcept { return size_; }
+    constexpr size_type max_size() const noexcept { return N; }
+    constexpr size_type capacity() const noexcept { return N; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    bool resize(size_type sz) { return resize(sz, T()); }
+    bool resize(size_type sz, const T& c);
+    void reserve(size_type n) { if (n > N) OverflowPolicy::overflow(); }
+    void shrink_to_fit() noexcept {}
+
+    reference operator[](size_type n) { return storage()[n]; }
+    constexpr const_reference operator[](size_type n) const { return storage()[n]; }
+    constexpr const_reference at(size_type n) const {
+        return n < size_ ? storage()[n] : (throw std::out_of_range("Vector subscript out of range"), storage()[0]);
+    }
+    reference at(size_type n);
+    reference front() { return storage()[0]; }
+    constexpr const_reference front() const { return storage()[0]; }
+    reference back() { return storage()[size_ - 1]; }
+    constexpr const_reference back() const { return storage()[size_ - 1]; }
+    pointer data() noexcept { return storage(); }
+    constexpr const T* data() const noexcept { return storage(); }
+
+    bool push_back(const T& x) { return emplace_back(x); }
+    bool push_back(T&& x) { return emplace_back(std::move(x)); }
+    void pop_back();
+    iterator insert(iterator position, const T& x) { return emplace(position, x); }
+    iterator insert(iterator position, T&& x) { return emplace(position, std::move(x)); }
+    iterator insert(iterator position, size_type n, const T& x);
+    template <class ForwardIterator, class = typename std::enable_if<!std::is_integral<ForwardIterator>::value>::type>
+        iterator insert(iterator position, ForwardIterator first, ForwardIterator last);
+    iterator insert(iterator position, std::initializer_list<T> il) { return insert(position, il.begin(), il.end()); }
+    iterator erase(iterator position) { return erase(position, position + 1); }
+    iterator erase(iterator first, iterator last);
+
+    template<class... Args> iterator emplace(iterator pos, Args&&... args);
+    template<class... Args> bool emplace_back(Args&&... args);
+
+    void swap(static_vector&) noexcept(std::is_nothrow_move_constructible<T>::value);
+    void clear() noexcept { erase(begin(), end()); }
+private:
+    static constexpr size_type fit(size_type n) {
+        return n <= N ? n : (OverflowPolicy::overflow(), N);
+    }
+    bool has_room(size_type n) { return n <= N - size_ || OverflowPolicy::overflow(); }
+    void shift(pointer first, pointer last, pointer dest, std::true_type);
+    void shift(pointer first, pointer last, pointer dest, std::false_type);
+    template <class Arg> void fill(pointer i, pointer old_end, Arg&& value);
+    template <class... Args> void construct(pointer p, Args&&... args) {
+        ::new (static_cast<void*>(p)) T(std::forward<Args>(args)...);
+    }
+};
+
+// Moves [first, last) into the possibly uninitialized slots starting at dest.
+template <class T, size_t N, class OverflowPolicy>
+void static_vector<T, N, OverflowPolicy>::shift(pointer first, pointer last, pointer dest, std::true_type) {
+    if (first != last) {
+        std::memmove(static_cast<void*>(dest), static_cast<const void*>(first), (last - first) * sizeof(T));
+    }
+}
+
+// Opens a gap by moving [first, last) up to dest. Slots past the old end are
+// raw storage and are move-constructed; the rest is move-assigned, leaving
+// moved-from elements in the part of the gap below the old end.
+template <class T, size_t N, class OverflowPolicy>
+void static_vector<T, N, OverflowPolicy>::shift(pointer first, pointer last, pointer dest, std::false_type) {
+    pointer end = storage() + size_;
+    pointer out = dest + (last - first);
+    while (last != first && out > end) {
+        construct(--out, std::move(*--last));
+    }
+    std::move_backward(first, last, out);
+}
+
+// Fills slot i of a gap opened below old_end. After a non-relocating shift
+// those slots still hold moved-from elements, which are assigned to.
+template <class T, size_t N, class OverflowPolicy>
+template <class Arg>
+void static_vector<T, N, OverflowPolicy>::fill(pointer i, pointer old_end, Arg&& value) {
+    if (!is_trivially_relocatable<T>::value && i < old_end) {
+        *i = std::forward<Arg>(value);
+    }
+    else {
+        construct(i, std::forward<Arg>(value));
+    }
+}
+
+template <class T, size_t N, class OverflowPolicy>
+static_vector<T, N, OverflowPolicy>::static_vector(size_type n) : storage_type() {
+    resize(fit(n));
+}
+
+template <class T, size_t N, class OverflowPolicy>
+template <class ForwardIterator, class>
+static_vector<T, N, OverflowPolicy>::static_vector(ForwardIterator first, ForwardIterator last) : storage_type() {
+    for (; first != last && (size_ < N || OverflowPolicy::overflow()); ++first) {
+        emplace_back(*first);
+    }
+}
+
+template <class T, size_t N, class OverflowPolicy>
+template <class ForwardIterator, class>
+bool static_vector<T, N, OverflowPolicy>::assign(ForwardIterator first, ForwardIterator last) {
+    if (static_cast<size_type>(std::distance(first, last)) > N && !OverflowPolicy::overflow()) {
+        return false;
+    }
+    clear();
+    for (; first != last; ++first) {
+        construct(storage() + size_, *first);
+        ++size_;
+    }
+    return true;
+}
+
+template <class T, size_t N, class OverflowPolicy>
+bool static_vector<T, N, OverflowPolicy>::assign(size_type n, const T& u) {
+    if (n > N && !OverflowPolicy::overflow()) {
+        return false;
+    }
+    clear();
+    return resize(n, u);
+}
+
+template <class T, size_t N, class OverflowPolicy>
+bool static_vector<T, N, OverflowPolicy>::resize(size_type sz, const T& c) {
+    if (sz <= size_) {
+        erase(begin() + sz, end());
+        return true;
+    }
+    if (!has_room(sz - size_)) {
+        return false;
+    }
+    while (size_ < sz) {
+        construct(storage() + size_, c);
+        ++size_;
+    }
+    return true;
+}
+
+template <class T, size_t N, class OverflowPolicy>
+typename static_vector<T, N, OverflowPolicy>::reference static_vector<T, N, OverflowPolicy>::at(size_type n) {
+    if (n >= size_) {
+        throw std::out_of_range("Vector subscript out of range");
+    }
+    return storage()[n];
+}
+
+template <class T, size_t N, class OverflowPolicy>
+void static_vector<T, N, OverflowPolicy>::pop_back() {
+    storage()[--size_].~T();
+}
+
+template <class T, size_t N, class OverflowPolicy>
+typename static_vector<T, N, OverflowPolicy>::iterator static_vector<T, N, OverflowPolicy>::insert(iterator position, size_type n, const T& x) {
+    if (!has_room(n)) {
+        return iterator();
+    }
+    // x may refer into the part of the vector that is about to move.
+    T value(x);
+    difference_type p = position - begin();
+    pointer old_end = end();
+    shift(position, old_end, position + n, is_trivially_relocatable<T>());
+    for (size_type i = 0; i < n; ++i) {
+        fill(position + i, old_end, value);
+    }
+    size_ += n;
+    return begin() + p;
+}
+
+template <class T, size_t N, class OverflowPolicy>
+template <class ForwardIterator, class>
+typename static_vector<T, N, OverflowPolicy>::iterator static_vector<T, N, OverflowPolicy>::insert(iterator position, ForwardIterator first, ForwardIterator last) {
+    size_type n = std::distance(first, last);
+    if (!has_room(n)) {
+        return iterator();
+    }
+    difference_type p = position - begin();
+    pointer old_end = end();
+    shift(position, old_end, position + n, is_trivially_relocatable<T>());
+    for (pointer i = position; first != last; ++first, ++i) {
+        fill(i, old_end, *first);
+    }
+    size_ += n;
+    return begin() + p;
+}
+
+template <class T, size_t N, class OverflowPolicy>
+typename static_vector<T, N, OverflowPolicy>::iterator static_vector<T, N, OverflowPolicy>::erase(iterator first, iterator last) {
+    if (first == last) {
+        return first;
+    }
+    pointer old_end = end();
+    if (is_trivially_relocatable<T>::value) {
+        for (auto i = first; i != last; ++i) {
+            i->~T();
+        }
+        shift(last, old_end, first, std::true_type());
+    }
+    else {
+        for (auto i = std::move(last, old_end, first); i != old_end; ++i) {
+            i->~T();
+        }
+    }
+    size_ -= last - first;
+    return first;
+}
+
+// The new element is built before anything moves, so a throwing constructor
+// leaves the vector untouched.
+template <class T, size_t N, class OverflowPolicy>
+template <class ... Args>
+typename static_vector<T, N, OverflowPolicy>::iterator static_vector<T, N, OverflowPolicy>::emplace(iterator pos, Args&&... args) {
+    if (!has_room(1)) {
+        return iterator();
+    }
+    if (pos == end()) {
+        construct(pos, std::forward<Args>(args)...);
+        ++size_;
+        return pos;
+    }
+    T value(std::forward<Args>(args)...);
+    pointer old_end = end();
+    shift(pos, old_end, pos + 1, is_trivially_relocatable<T>());
+    fill(pos, old_end, std::move(value));
+    ++size_;
+    return pos;
+}
+
+template <class T, size_t N, class OverflowPolicy>
+template <class ... Args>
+bool static_vector<T, N, OverflowPolicy>::emplace_back(Args&&... args) {
+    if (!has_room(1)) {
+        return false;
+    }
+    construct(storage() + size_, std::forward<Args>(args)...);
+    ++size_;
+    return true;
+}
+
+template <class T, size_t N, class OverflowPolicy>
+void static_vector<T, N, OverflowPolicy>::swap(static_vector& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+    static_vector* shorter = size_ < other.size_ ? this : &other;
+    static_vector* longer = shorter == this ? &other : this;
+    size_type common = shorter->size_;
+    for (size_type i = 0; i < common; ++i) {
+        using std::swap;
+        swap(storage()[i], other.storage()[i]);
+    }
+    for (size_type i = common; i < longer->size_; ++i) {
+        shorter->construct(shorter->storage() + i, std::move(longer->storage()[i]));
+    }
+    shorter->size_ = longer->size_;
+    longer->erase(longer->begin() + common, longer->end());
+}
+
+template <class T, size_t N, class OverflowPolicy>
+bool operator==(const static_vector<T, N, OverflowPolicy>& a, const static_vector<T, N, OverflowPolicy>& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template <class T, size_t N, class OverflowPolicy>
+bool operator!=(const static_vector<T, N, OverflowPolicy>& a, const static_vector<T, N, OverflowPolicy>& b) {
+    return !(a == b);
+}
+
+}
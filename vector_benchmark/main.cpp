@@ -2,10 +2,70 @@
 #include "benchpress.hpp"
 #include "allocator.hpp"
 #include "my_vector.hpp"
+#include "small_vector.hpp"
+#include "arena.hpp"
+#include "reserved_vector.hpp"
+#include "mapped_vector.hpp"
+#include "stable_vector.hpp"
+#include "concurrent_vector.hpp"
+#include "soa_vector.hpp"
+#include "parallel.hpp"
+#include "cow_vector.hpp"
 #include <vector>
+#include <iostream>
+#include <cstdio>
+#include <mutex>
+#include <numeric>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
 
 typedef std::vector<int, my::allocator<int>> std_vector_my_alloc;
 typedef my::vector<int, my::allocator<int>> my_vector_my_alloc;
+typedef my::vector<int, std::allocator<int>, my::power_of_two_growth> power_of_two_vector;
+typedef my::vector<int, std::allocator<int>, my::one_and_half_growth> one_and_half_vector;
+typedef my::vector<int, std::allocator<int>, my::fixed_step_growth<65536>> fixed_step_vector;
+typedef my::vector<int, std::allocator<int>, my::size_class_growth> size_class_vector;
+typedef my::vector<int, my::arena_allocator<int>> arena_vector;
+
+// std::allocator that counts calls to allocate, so the small-size benchmarks
+// can report how often each container reaches the allocator.
+size_t allocation_count = 0;
+
+template <class T>
+struct counting_allocator : std::allocator<T> {
+    template <class U> struct rebind { typedef counting_allocator<U> other; };
+    counting_allocator() noexcept {}
+    template <class U> counting_allocator(const counting_allocator<U>&) noexcept {}
+    T* allocate(size_t n) {
+        ++allocation_count;
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+typedef my::vector<int, counting_allocator<int>> counted_vector;
+typedef my::small_vector<int, 8, counting_allocator<int>> counted_small_vector;
+
+// Peak RSS is process-wide, so compare growth policies by running one of them
+// per process, e.g. --bench "growth: one and a half".
+struct peak_rss_report {
+    ~peak_rss_report() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+        size_t peak_kb = counters.PeakWorkingSetSize / 1024;
+#else
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        size_t peak_kb = static_cast<size_t>(usage.ru_maxrss);
+#endif
+        std::cout << "peak RSS: " << peak_kb << " KB" << std::endl;
+    }
+} peak_rss;
 
 BENCHMARK("std::vector with std::allocator", [](benchpress::context* ctx) {
     for (size_t i = 0; i < ctx->num_iterations(); ++i) {
@@ -42,3 +102,710 @@ BENCHMARK("my::vector with my::allocator", [](benchpress::context* ctx) {
         }
     }
 })
+
+template <class Vector>
+void parallel_push_back(benchpress::context* ctx) {
+    ctx->run_parallel([](benchpress::parallel_context* pc) {
+        while (pc->next()) {
+            Vector a;
+            for (auto j = 0; j <= 1000; ++j) {
+                a.push_back(100);
+            }
+            benchpress::escape(a.data());
+        }
+    });
+}
+
+BENCHMARK("parallel: std::vector with std::allocator", parallel_push_back<std::vector<int>>)
+BENCHMARK("parallel: std::vector with my::allocator", parallel_push_back<std_vector_my_alloc>)
+BENCHMARK("parallel: my::vector with my::allocator", parallel_push_back<my_vector_my_alloc>)
+
+template <class Vector>
+void push_back_growth(benchpress::context* ctx) {
+    const size_t count = 3000000;
+    ctx->set_bytes(count * sizeof(int));
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        Vector a;
+        for (size_t j = 0; j < count; ++j) {
+            a.push_back(100);
+        }
+        benchpress::escape(a.data());
+    }
+}
+
+BENCHMARK("growth: power of two", push_back_growth<power_of_two_vector>)
+BENCHMARK("growth: one and a half", push_back_growth<one_and_half_vector>)
+BENCHMARK("growth: fixed step 64K", push_back_growth<fixed_step_vector>)
+BENCHMARK("growth: size class", push_back_growth<size_class_vector>)
+BENCHMARK("growth: reserved address space", push_back_growth<my::reserved_vector<int>>)
+
+template <class Vector>
+size_t allocations_for(int count) {
+    allocation_count = 0;
+    Vector a;
+    for (int j = 0; j < count; ++j) {
+        a.push_back(j);
+    }
+    return allocation_count;
+}
+
+struct small_size_report {
+    ~small_size_report() {
+        std::cout << "allocations per vector (elements: my::vector / my::small_vector<int, 8>)" << std::endl;
+        for (int count : { 1, 4, 8, 16 }) {
+            std::cout << "    " << count << ": " << allocations_for<counted_vector>(count)
+                << " / " << allocations_for<counted_small_vector>(count) << std::endl;
+        }
+    }
+} small_size;
+
+template <class Vector, int Count>
+void small_push_back(benchpress::context* ctx) {
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        Vector a;
+        for (int j = 0; j < Count; ++j) {
+            a.push_back(j);
+        }
+        benchpress::escape(a.data());
+    }
+}
+
+BENCHMARK("small: my::vector, 4 elements", (small_push_back<counted_vector, 4>))
+BENCHMARK("small: my::small_vector<8>, 4 elements", (small_push_back<counted_small_vector, 4>))
+BENCHMARK("small: my::vector, 8 elements", (small_push_back<counted_vector, 8>))
+BENCHMARK("small: my::small_vector<8>, 8 elements", (small_push_back<counted_small_vector, 8>))
+BENCHMARK("small: my::vector, 16 elements", (small_push_back<counted_vector, 16>))
+BENCHMARK("small: my::small_vector<8>, 16 elements", (small_push_back<counted_small_vector, 16>))
+
+// A request builds a few hundred short-lived vectors and drops them together.
+template <class Vector, class Make>
+void per_request(benchpress::context* ctx, Make make) {
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        std::vector<Vector> vectors;
+        vectors.reserve(200);
+        for (int v = 0; v < 200; ++v) {
+            vectors.push_back(make());
+            for (int j = 0; j < 20 + v % 50; ++j) {
+                vectors.back().push_back(j);
+            }
+        }
+        benchpress::escape(vectors.data());
+    }
+}
+
+BENCHMARK("per request: my::vector with std::allocator", [](benchpress::context* ctx) {
+    per_request<my::vector<int>>(ctx, []() { return my::vector<int>(); });
+})
+
+BENCHMARK("per request: my::vector with my::allocator", [](benchpress::context* ctx) {
+    per_request<my_vector_my_alloc>(ctx, []() { return my_vector_my_alloc(); });
+})
+
+BENCHMARK("per request: my::vector with my::arena_allocator", [](benchpress::context* ctx) {
+    my::arena a;
+    my::arena_allocator<int> al(a);
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        {
+            std::vector<arena_vector> vectors;
+            vectors.reserve(200);
+            for (int v = 0; v < 200; ++v) {
+                vectors.emplace_back(al);
+                for (int j = 0; j < 20 + v % 50; ++j) {
+                    vectors.back().push_back(j);
+                }
+            }
+            benchpress::escape(vectors.data());
+        }
+        a.reset();
+    }
+})
+
+// Startup cost of a 1M-entry lookup table: computing it again versus mapping
+// the copy saved by a previous run.
+const size_t table_size = 1000000;
+
+template <class Vector>
+void fill_table(Vector& table) {
+    for (size_t j = 0; j < table_size; ++j) {
+        table.push_back(static_cast<unsigned>(j * 2654435761u) >> 7);
+    }
+}
+
+BENCHMARK("startup: rebuild table in my::vector", [](benchpress::context* ctx) {
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        my::vector<unsigned> table;
+        fill_table(table);
+        benchpress::escape(table.data());
+    }
+})
+
+BENCHMARK("startup: reopen my::mapped_vector", [](benchpress::context* ctx) {
+    const char* path = "startup_table.bin";
+    std::remove(path);
+    {
+        my::mapped_vector<unsigned> table(path);
+        fill_table(table);
+    }
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        my::mapped_vector<unsigned> table(path);
+        benchpress::escape(&table.back());
+    }
+    ctx->stop_timer();
+    std::remove(path);
+})
+
+// Scans a 1GB vector whose buffer comes either from a pool arena or from a
+// huge-page mapping of its own. Sequential scans are bandwidth bound; the
+// random gather is where dTLB misses show.
+void scan_1gb(benchpress::context* ctx, size_t large_threshold, bool random) {
+    my::set_large_allocation_threshold(large_threshold);
+    {
+        my_vector_my_alloc a;
+        a.resize((size_t(1) << 30) / sizeof(int), 1);
+        const size_t mask = a.size() - 1;
+        const size_t reads = random ? size_t(1) << 24 : a.size();
+        ctx->set_bytes(reads * sizeof(int));
+        ctx->reset_timer();
+        for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+            long long sum = 0;
+            if (random) {
+                size_t index = 0;
+                for (size_t j = 0; j < reads; ++j) {
+                    index = (index * 2862933555777941757ull + 3037000493ull) & mask;
+                    sum += a[index];
+                }
+            }
+            else {
+                for (size_t j = 0; j < reads; ++j) {
+                    sum += a[j];
+                }
+            }
+            benchpress::escape(&sum);
+        }
+        ctx->stop_timer();
+    }
+    my::set_large_allocation_threshold(my::memory_pool::default_large_threshold);
+}
+
+BENCHMARK("scan 1GB: pool arena", [](benchpress::context* ctx) {
+    scan_1gb(ctx, my::memory_pool::max_size, false);
+})
+
+BENCHMARK("scan 1GB: huge pages", [](benchpress::context* ctx) {
+    scan_1gb(ctx, my::memory_pool::default_large_threshold, false);
+})
+
+BENCHMARK("scan 1GB: random gather, pool arena", [](benchpress::context* ctx) {
+    scan_1gb(ctx, my::memory_pool::max_size, true);
+})
+
+BENCHMARK("scan 1GB: random gather, huge pages", [](benchpress::context* ctx) {
+    scan_1gb(ctx, my::memory_pool::default_large_threshold, true);
+})
+
+// Growing a vector to 1GB by push_back. Past the large allocation threshold
+// my::allocator remaps the buffer instead of copying it.
+template <class Vector>
+void large_growth(benchpress::context* ctx) {
+    const size_t count = (size_t(1) << 30) / sizeof(double);
+    ctx->set_bytes(count * sizeof(double));
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        Vector a;
+        for (size_t j = 0; j < count; ++j) {
+            a.push_back(1.0);
+        }
+        benchpress::escape(a.data());
+    }
+}
+
+BENCHMARK("large growth: my::vector with std::allocator", large_growth<my::vector<double>>)
+BENCHMARK("large growth: my::vector with my::allocator", (large_growth<my::vector<double, my::allocator<double>>>))
+
+// my::stable_vector against my::vector, both on my::allocator: building by
+// push_back, random reads by index and a sequential pass with iterators.
+typedef my::stable_vector<int> stable_vector_my_alloc;
+const size_t stable_count = 1 << 22;
+
+template <class Vector>
+void stable_push_back(benchpress::context* ctx) {
+    ctx->set_bytes(stable_count * sizeof(int));
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        Vector a;
+        for (size_t j = 0; j < stable_count; ++j) {
+            a.push_back(static_cast<int>(j));
+        }
+        benchpress::escape(&a[0]);
+    }
+}
+
+template <class Vector>
+void stable_random_access(benchpress::context* ctx) {
+    Vector a;
+    for (size_t j = 0; j < stable_count; ++j) {
+        a.push_back(static_cast<int>(j));
+    }
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        long long sum = 0;
+        size_t index = 0;
+        for (size_t j = 0; j < stable_count; ++j) {
+            index = (index * 2862933555777941757ull + 3037000493ull) & (stable_count - 1);
+            sum += a[index];
+        }
+        benchpress::escape(&sum);
+    }
+}
+
+template <class Vector>
+void stable_iteration(benchpress::context* ctx) {
+    Vector a;
+    for (size_t j = 0; j < stable_count; ++j) {
+        a.push_back(static_cast<int>(j));
+    }
+    ctx->set_bytes(stable_count * sizeof(int));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        long long sum = 0;
+        for (auto x : a) {
+            sum += x;
+        }
+        benchpress::escape(&sum);
+    }
+}
+
+BENCHMARK("stable: push_back, my::vector", stable_push_back<my_vector_my_alloc>)
+BENCHMARK("stable: push_back, my::stable_vector", stable_push_back<stable_vector_my_alloc>)
+BENCHMARK("stable: random access, my::vector", stable_random_access<my_vector_my_alloc>)
+BENCHMARK("stable: random access, my::stable_vector", stable_random_access<stable_vector_my_alloc>)
+BENCHMARK("stable: iteration, my::vector", stable_iteration<my_vector_my_alloc>)
+BENCHMARK("stable: iteration, my::stable_vector", stable_iteration<stable_vector_my_alloc>)
+
+// All threads append into one shared container, a few events per iteration.
+BENCHMARK("shared append: my::vector behind a mutex", [](benchpress::context* ctx) {
+    my_vector_my_alloc events;
+    std::mutex mutex;
+    ctx->run_parallel([&](benchpress::parallel_context* pc) {
+        while (pc->next()) {
+            for (int j = 0; j < 8; ++j) {
+                std::lock_guard<std::mutex> lock(mutex);
+                events.push_back(j);
+            }
+        }
+    });
+    benchpress::escape(events.data());
+})
+
+BENCHMARK("shared append: my::concurrent_vector", [](benchpress::context* ctx) {
+    my::concurrent_vector<int> events;
+    ctx->run_parallel([&](benchpress::parallel_context* pc) {
+        while (pc->next()) {
+            for (int j = 0; j < 8; ++j) {
+                events.push_back(j);
+            }
+        }
+    });
+    benchpress::escape(&events);
+})
+
+// Summing one field of a 64-byte record: rows in a my::vector against the
+// same fields as columns of a my::soa_vector.
+struct record {
+    double price;
+    double quantity;
+    long long id;
+    long long timestamp;
+    double bid;
+    double ask;
+    long long venue;
+    long long flags;
+};
+
+typedef my::soa_vector<double, double, long long, long long, double, double, long long, long long> record_columns;
+const size_t record_count = 1 << 20;
+typedef my::vector<record, my::allocator<record>> my_vector_records;
+
+BENCHMARK("field scan: my::vector<record>", [](benchpress::context* ctx) {
+    my_vector_records records;
+    for (size_t j = 0; j < record_count; ++j) {
+        records.push_back({ 1.0, 2.0, 0, 0, 0.0, 0.0, 0, 0 });
+    }
+    ctx->set_bytes(record_count * sizeof(double));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        double sum = 0;
+        for (size_t j = 0; j < record_count; ++j) {
+            sum += records[j].price;
+        }
+        benchpress::escape(&sum);
+    }
+})
+
+BENCHMARK("field scan: my::soa_vector column", [](benchpress::context* ctx) {
+    record_columns records;
+    for (size_t j = 0; j < record_count; ++j) {
+        records.push_back(1.0, 2.0, 0, 0, 0.0, 0.0, 0, 0);
+    }
+    ctx->set_bytes(record_count * sizeof(double));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        double sum = 0;
+        for (double price : records.column<0>()) {
+            sum += price;
+        }
+        benchpress::escape(&sum);
+    }
+})
+
+// Bulk kernels over 64KB of ints: my::vector goes through the SIMD kernels in
+// simd.hpp, std::vector through the standard algorithms. The destinations
+// are reserved up front, so only the kernels are timed.
+const size_t kernel_count = 1 << 14;
+
+template <class Vector>
+void kernel_fill(benchpress::context* ctx) {
+    Vector v;
+    v.reserve(kernel_count);
+    ctx->set_bytes(kernel_count * sizeof(int));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        v.assign(kernel_count, static_cast<int>(i));
+        benchpress::escape(v.data());
+    }
+}
+
+template <class Vector>
+void kernel_copy(benchpress::context* ctx) {
+    Vector v(kernel_count, 1), copy;
+    copy.reserve(kernel_count);
+    ctx->set_bytes(kernel_count * sizeof(int));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        copy.assign(v.data(), v.data() + kernel_count);
+        benchpress::escape(copy.data());
+    }
+}
+
+template <class Vector>
+void kernel_equal(benchpress::context* ctx) {
+    Vector a(kernel_count, 1), b(kernel_count, 1);
+    ctx->set_bytes(2 * kernel_count * sizeof(int));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        bool same = a == b;
+        benchpress::escape(&same);
+    }
+}
+
+template <class Vector>
+void kernel_compare(benchpress::context* ctx) {
+    Vector a(kernel_count, 1), b(kernel_count, 1);
+    b.back() = 2;
+    ctx->set_bytes(2 * kernel_count * sizeof(int));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        bool less = a < b;
+        benchpress::escape(&less);
+    }
+}
+
+BENCHMARK("kernels: fill, std::vector", kernel_fill<std_vector_my_alloc>)
+BENCHMARK("kernels: fill, my::vector", kernel_fill<my_vector_my_alloc>)
+BENCHMARK("kernels: copy, std::vector", kernel_copy<std_vector_my_alloc>)
+BENCHMARK("kernels: copy, my::vector", kernel_copy<my_vector_my_alloc>)
+BENCHMARK("kernels: equal, std::vector", kernel_equal<std_vector_my_alloc>)
+BENCHMARK("kernels: equal, my::vector", kernel_equal<my_vector_my_alloc>)
+BENCHMARK("kernels: compare, std::vector", kernel_compare<std_vector_my_alloc>)
+BENCHMARK("kernels: compare, my::vector", kernel_compare<my_vector_my_alloc>)
+
+// Membership queries that scan the whole vector: the value is missing, so
+// find looks at every element. std::find and std::count run over the same
+// my::vector data.
+const size_t search_size = 1 << 16;
+
+template <class T>
+void search_std_find(benchpress::context* ctx) {
+    my::vector<T, my::allocator<T>> v(search_size, T(1));
+    ctx->set_bytes(search_size * sizeof(T));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        bool found = std::find(v.data(), v.data() + v.size(), T(2)) != v.data() + v.size();
+        benchpress::escape(&found);
+    }
+}
+
+template <class T>
+void search_find(benchpress::context* ctx) {
+    my::vector<T, my::allocator<T>> v(search_size, T(1));
+    ctx->set_bytes(search_size * sizeof(T));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        bool found = my::contains(v, T(2));
+        benchpress::escape(&found);
+    }
+}
+
+template <class T>
+void search_std_count(benchpress::context* ctx) {
+    my::vector<T, my::allocator<T>> v(search_size, T(1));
+    ctx->set_bytes(search_size * sizeof(T));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        size_t found = std::count(v.data(), v.data() + v.size(), T(1));
+        benchpress::escape(&found);
+    }
+}
+
+template <class T>
+void search_count(benchpress::context* ctx) {
+    my::vector<T, my::allocator<T>> v(search_size, T(1));
+    ctx->set_bytes(search_size * sizeof(T));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        size_t found = my::count(v, T(1));
+        benchpress::escape(&found);
+    }
+}
+
+template <class T>
+void search_std_find_any(benchpress::context* ctx) {
+    my::vector<T, my::allocator<T>> v(search_size, T(1));
+    const T wanted[] = { T(2), T(3), T(4), T(5) };
+    ctx->set_bytes(search_size * sizeof(T));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        bool found = std::find_first_of(v.data(), v.data() + v.size(), wanted, wanted + 4) != v.data() + v.size();
+        benchpress::escape(&found);
+    }
+}
+
+template <class T>
+void search_find_any(benchpress::context* ctx) {
+    my::vector<T, my::allocator<T>> v(search_size, T(1));
+    ctx->set_bytes(search_size * sizeof(T));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        bool found = my::find_if_eq_any(v, { T(2), T(3), T(4), T(5) }) != v.end();
+        benchpress::escape(&found);
+    }
+}
+
+BENCHMARK("search: int, std::find", search_std_find<int>)
+BENCHMARK("search: int, my::contains", search_find<int>)
+BENCHMARK("search: int, std::count", search_std_count<int>)
+BENCHMARK("search: int, my::count", search_count<int>)
+BENCHMARK("search: int, std::find_first_of 4 values", search_std_find_any<int>)
+BENCHMARK("search: int, my::find_if_eq_any 4 values", search_find_any<int>)
+BENCHMARK("search: uint64_t, std::find", search_std_find<uint64_t>)
+BENCHMARK("search: uint64_t, my::contains", search_find<uint64_t>)
+BENCHMARK("search: uint64_t, std::count", search_std_count<uint64_t>)
+BENCHMARK("search: uint64_t, my::count", search_count<uint64_t>)
+BENCHMARK("search: float, std::find", search_std_find<float>)
+BENCHMARK("search: float, my::contains", search_find<float>)
+
+// my::par algorithms over 8MB of ints on pools of 1, 2 and 4 threads and of
+// --cpu threads, next to the serial standard algorithm. Sorting copies the
+// unsorted input outside the timed region. Sums are taken over unsigned
+// elements, which wrap instead of overflowing.
+const size_t par_count = 1 << 21;
+typedef my::vector<double, my::allocator<double>> par_doubles;
+typedef my::vector<unsigned, my::allocator<unsigned>> par_unsigned;
+
+template <class Vector = my_vector_my_alloc>
+Vector par_input() {
+    Vector v(par_count);
+    unsigned x = 12345;
+    for (auto& e : v) {
+        x = x * 1103515245 + 12345;
+        e = static_cast<typename Vector::value_type>(x >> 8);
+    }
+    return v;
+}
+
+template <size_t Threads>
+size_t par_threads(benchpress::context* ctx) {
+    return Threads > 0 ? Threads : ctx->num_threads();
+}
+
+template <size_t Threads>
+void par_sort(benchpress::context* ctx) {
+    my::thread_pool pool(par_threads<Threads>(ctx));
+    my_vector_my_alloc input = par_input();
+    ctx->set_bytes(par_count * sizeof(int));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        ctx->stop_timer();
+        my_vector_my_alloc v(input);
+        ctx->start_timer();
+        my::par::sort(pool, v);
+        benchpress::escape(v.data());
+    }
+}
+
+template <size_t Threads>
+void par_transform(benchpress::context* ctx) {
+    my::thread_pool pool(par_threads<Threads>(ctx));
+    my_vector_my_alloc input = par_input();
+    par_doubles output;
+    ctx->set_bytes(par_count * sizeof(int));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        my::par::transform(pool, input, output, [](int x) { return x * 0.5 + 1.0; });
+        benchpress::escape(output.data());
+    }
+}
+
+template <size_t Threads>
+void par_for_each(benchpress::context* ctx) {
+    my::thread_pool pool(par_threads<Threads>(ctx));
+    my_vector_my_alloc v = par_input();
+    ctx->set_bytes(par_count * sizeof(int));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        my::par::for_each(pool, v, [](int& x) { x = static_cast<int>(static_cast<unsigned>(x) * 3u + 1u); });
+        benchpress::escape(v.data());
+    }
+}
+
+template <size_t Threads>
+void par_reduce(benchpress::context* ctx) {
+    my::thread_pool pool(par_threads<Threads>(ctx));
+    par_unsigned v = par_input<par_unsigned>();
+    ctx->set_bytes(par_count * sizeof(unsigned));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        unsigned sum = my::par::reduce(pool, v, 0u);
+        benchpress::escape(&sum);
+    }
+}
+
+template <size_t Threads>
+void par_inclusive_scan(benchpress::context* ctx) {
+    my::thread_pool pool(par_threads<Threads>(ctx));
+    par_unsigned v = par_input<par_unsigned>();
+    par_unsigned prefix;
+    ctx->set_bytes(par_count * sizeof(unsigned));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        my::par::inclusive_scan(pool, v, prefix);
+        benchpress::escape(prefix.data());
+    }
+}
+
+BENCHMARK("par sort: std::sort", [](benchpress::context* ctx) {
+    my_vector_my_alloc input = par_input();
+    ctx->set_bytes(par_count * sizeof(int));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        ctx->stop_timer();
+        my_vector_my_alloc v(input);
+        ctx->start_timer();
+        std::sort(v.data(), v.data() + v.size());
+        benchpress::escape(v.data());
+    }
+})
+BENCHMARK("par sort: 1 thread", par_sort<1>)
+BENCHMARK("par sort: 2 threads", par_sort<2>)
+BENCHMARK("par sort: 4 threads", par_sort<4>)
+BENCHMARK("par sort: --cpu threads", par_sort<0>)
+
+BENCHMARK("par transform: std::transform", [](benchpress::context* ctx) {
+    my_vector_my_alloc input = par_input();
+    par_doubles output(par_count);
+    ctx->set_bytes(par_count * sizeof(int));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        std::transform(input.data(), input.data() + par_count, output.data(), [](int x) { return x * 0.5 + 1.0; });
+        benchpress::escape(output.data());
+    }
+})
+BENCHMARK("par transform: 1 thread", par_transform<1>)
+BENCHMARK("par transform: 2 threads", par_transform<2>)
+BENCHMARK("par transform: 4 threads", par_transform<4>)
+BENCHMARK("par transform: --cpu threads", par_transform<0>)
+
+BENCHMARK("par for_each: std::for_each", [](benchpress::context* ctx) {
+    my_vector_my_alloc v = par_input();
+    ctx->set_bytes(par_count * sizeof(int));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        std::for_each(v.data(), v.data() + par_count, [](int& x) { x = static_cast<int>(static_cast<unsigned>(x) * 3u + 1u); });
+        benchpress::escape(v.data());
+    }
+})
+BENCHMARK("par for_each: 1 thread", par_for_each<1>)
+BENCHMARK("par for_each: 2 threads", par_for_each<2>)
+BENCHMARK("par for_each: 4 threads", par_for_each<4>)
+BENCHMARK("par for_each: --cpu threads", par_for_each<0>)
+
+BENCHMARK("par reduce: std::accumulate", [](benchpress::context* ctx) {
+    par_unsigned v = par_input<par_unsigned>();
+    ctx->set_bytes(par_count * sizeof(unsigned));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        unsigned sum = std::accumulate(v.data(), v.data() + par_count, 0u);
+        benchpress::escape(&sum);
+    }
+})
+BENCHMARK("par reduce: 1 thread", par_reduce<1>)
+BENCHMARK("par reduce: 2 threads", par_reduce<2>)
+BENCHMARK("par reduce: 4 threads", par_reduce<4>)
+BENCHMARK("par reduce: --cpu threads", par_reduce<0>)
+
+BENCHMARK("par inclusive_scan: std::partial_sum", [](benchpress::context* ctx) {
+    par_unsigned v = par_input<par_unsigned>();
+    par_unsigned prefix(par_count);
+    ctx->set_bytes(par_count * sizeof(unsigned));
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        std::partial_sum(v.data(), v.data() + par_count, prefix.data());
+        benchpress::escape(prefix.data());
+    }
+})
+BENCHMARK("par inclusive_scan: 1 thread", par_inclusive_scan<1>)
+BENCHMARK("par inclusive_scan: 2 threads", par_inclusive_scan<2>)
+BENCHMARK("par inclusive_scan: 4 threads", par_inclusive_scan<4>)
+BENCHMARK("par inclusive_scan: --cpu threads", par_inclusive_scan<0>)
+
+// Passing a 64KB configuration vector by value to a function that only reads
+// it: my::vector copies the elements on every call, my::cow_vector shares
+// them. The write case modifies the copy, which costs cow_vector a clone.
+const size_t cow_count = 1 << 14;
+typedef my::cow_vector<int> cow_vector_my_alloc;
+
+template <class Vector>
+long long cow_read_config(Vector config) {
+    const Vector& read = config;
+    return read[0] + read[read.size() - 1];
+}
+
+template <class Vector>
+long long cow_write_config(Vector config) {
+    config[0] += 1;
+    return config[0];
+}
+
+template <class Vector>
+void cow_pass_by_value(benchpress::context* ctx) {
+    Vector config(cow_count, 1);
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        long long x = cow_read_config(config);
+        benchpress::escape(&x);
+    }
+}
+
+template <class Vector>
+void cow_modify_copy(benchpress::context* ctx) {
+    Vector config(cow_count, 1);
+    ctx->reset_timer();
+    for (size_t i = 0; i < ctx->num_iterations(); ++i) {
+        long long x = cow_write_config(config);
+        benchpress::escape(&x);
+    }
+}
+
+BENCHMARK("cow: pass by value, my::vector", cow_pass_by_value<my_vector_my_alloc>)
+BENCHMARK("cow: pass by value, my::cow_vector", cow_pass_by_value<cow_vector_my_alloc>)
+BENCHMARK("cow: modify a copy, my::vector", cow_modify_copy<my_vector_my_alloc>)
+BENCHMARK("cow: modify a copy, my::cow_vector", cow_modify_copy<cow_vector_my_alloc>)